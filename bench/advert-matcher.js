@@ -0,0 +1,105 @@
+/**
+ * Advertisement matcher benchmark.
+ *
+ * Classifies a synthetic stream of advert reports, as a busy environment
+ * delivers them to the scanner, and reports throughput for the original
+ * per-report matching (lower-casing the name and every pattern, linear
+ * service UUID search), the compiled matcher without its cache, and the
+ * compiled matcher with the per-address cache.
+ *
+ * Usage: node bench/advert-matcher.js [--reports 1000000] [--devices 200]
+ *                                     [--patterns 4] [--compatible 5]
+ *
+ * --devices is the number of distinct advertisers the reports rotate
+ * through; --compatible is how many of them match.
+ */
+
+const { performance } = require('perf_hooks');
+const { AdvertMatcher } = require('../lib/advert-matcher');
+
+const SERVICE_UUID = '0000fff000001000800000805f9b34fb';
+
+function parseArgs(argv) {
+  const options = { reports: 1000000, devices: 200, patterns: 4, compatible: 5 };
+  for (let i = 0; i < argv.length; i += 2) {
+    const key = argv[i].replace(/^--/, '').replace(/-(\w)/g, (_, c) => c.toUpperCase());
+    if (!(key in options)) throw new Error(`Unknown option: ${argv[i]}`);
+    options[key] = Number(argv[i + 1]);
+  }
+  return options;
+}
+
+function makePeripherals(options) {
+  const peripherals = [];
+  for (let i = 0; i < options.devices; i++) {
+    const address = `d4:${(i >> 8).toString(16).padStart(2, '0')}:${(i & 0xff).toString(16).padStart(2, '0')}:00:00:00`;
+    const compatible = i < options.compatible;
+    peripherals.push({
+      id: address.replace(/:/g, ''),
+      address,
+      advertisement: {
+        localName: compatible && i % 2 === 0 ? `Pet Collar ${i}` : `Phone-${i} Galaxy Buds`,
+        serviceUuids: compatible && i % 2 === 1
+          ? ['180f', SERVICE_UUID]
+          : ['180f', '180a', `0000fe${(i % 100).toString().padStart(2, '0')}00001000800000805f9b34fb`],
+      },
+    });
+  }
+  return peripherals;
+}
+
+// The scanner's matching before the compiled matcher
+function legacyMatch(peripheral, namePatterns, serviceUuid) {
+  const name = peripheral.advertisement?.localName || 'Unknown';
+  const serviceUuids = peripheral.advertisement?.serviceUuids || [];
+  const hasMatchingService = serviceUuid ? serviceUuids.includes(serviceUuid) : false;
+  const matchesNamePattern = namePatterns.length > 0 &&
+    namePatterns.some(pattern => name.toLowerCase().includes(pattern.toLowerCase()));
+  return hasMatchingService ? 'service-uuid' : (matchesNamePattern ? 'name-pattern' : 'none');
+}
+
+function run(name, peripherals, reports, classify) {
+  let compatible = 0;
+  const start = performance.now();
+  for (let i = 0; i < reports; i++) {
+    if (classify(peripherals[i % peripherals.length]) !== 'none') compatible++;
+  }
+  const ms = performance.now() - start;
+  return {
+    matcher: name,
+    'reports/s': Math.round(reports / (ms / 1000)).toLocaleString('en-US'),
+    'ns/report': ((ms * 1e6) / reports).toFixed(0),
+    compatible,
+  };
+}
+
+function main() {
+  const options = parseArgs(process.argv.slice(2));
+  const namePatterns = ['Collar', 'PetTrainer', 'XG-', 'Dog Shock', 'Trainer-Pro', 'BTT'].slice(0, Math.max(1, options.patterns));
+  const peripherals = makePeripherals(options);
+
+  const compiled = new AdvertMatcher({ serviceUuids: [SERVICE_UUID], namePatterns, cacheSize: 0 });
+  const cached = new AdvertMatcher({ serviceUuids: [SERVICE_UUID], namePatterns });
+
+  // Warm up the JIT for each variant before measuring
+  const warmup = Math.min(options.reports, 100000);
+  run('', peripherals, warmup, p => legacyMatch(p, namePatterns, SERVICE_UUID));
+  run('', peripherals, warmup, p => compiled.match(p));
+  run('', peripherals, warmup, p => cached.match(p));
+
+  const rows = [
+    run('per-report lower-case', peripherals, options.reports, p => legacyMatch(p, namePatterns, SERVICE_UUID)),
+    run('compiled', peripherals, options.reports, p => compiled.match(p)),
+    run('compiled + cache', peripherals, options.reports, p => cached.match(p)),
+  ];
+  if (new Set(rows.map(row => row.compatible)).size !== 1) {
+    throw new Error('Matchers disagree on compatible reports');
+  }
+
+  console.log(`${options.reports} reports from ${options.devices} advertisers, ${namePatterns.length} name patterns`);
+  console.table(rows);
+  const stats = cached.getStats();
+  console.log(`cache: ${stats.hits} hits, ${stats.misses} misses, ${stats.cached} entries`);
+}
+
+main();
@@ -0,0 +1,134 @@
+/**
+ * Connect, reconnect and scan latency benchmark.
+ *
+ * Runs BleDevice against the simulated adapter (lib/sim-noble.js) and
+ * reports how long it takes to find the device in a scan, make the first
+ * connection (including service discovery), and recover from injected
+ * link drops (reconnect with cached GATT handles).
+ *
+ * The simulator keeps characteristic objects valid across connections, as
+ * noble does on macOS. With noble's HCI bindings (Linux, Windows) the GATT
+ * cache is off and reconnects include service discovery, so the reconnect
+ * figure here is the macOS case.
+ *
+ * Usage: node bench/connect.js [--runs 20] [--ci 30] [--advert-interval 100]
+ *                              [--devices 20] [--seed 1] [--module btt-xg]
+ *
+ * --devices adds unrelated advertisers around the target so scan filtering
+ * is exercised too.
+ */
+
+const { performance } = require('perf_hooks');
+const { BleDevice } = require('../lib/ble-device');
+const { loadDeviceModule } = require('../lib/device-loader');
+const { Logger } = require('../lib/logger');
+const { scanSchedulerFor } = require('../lib/scan-scheduler');
+
+const TARGET = 'c0:de:00:00:00:01';
+
+function parseArgs(argv) {
+  const options = { runs: 20, ci: 30, advertInterval: 100, devices: 20, seed: 1, module: 'btt-xg' };
+  for (let i = 0; i < argv.length; i += 2) {
+    const key = argv[i].replace(/^--/, '').replace(/-(\w)/g, (_, c) => c.toUpperCase());
+    if (!(key in options)) throw new Error(`Unknown option: ${argv[i]}`);
+    options[key] = key === 'module' ? argv[i + 1] : Number(argv[i + 1]);
+  }
+  return options;
+}
+
+function summarize(name, samples) {
+  const sorted = samples.slice().sort((a, b) => a - b);
+  const at = p => sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+  return {
+    stage: name,
+    runs: sorted.length,
+    'min ms': sorted[0].toFixed(1),
+    'p50 ms': at(0.5).toFixed(1),
+    'p95 ms': at(0.95).toFixed(1),
+    'max ms': sorted[sorted.length - 1].toFixed(1),
+  };
+}
+
+function createScenario(options) {
+  const peripherals = [{
+    address: TARGET,
+    advertInterval: options.advertInterval,
+    connectionInterval: options.ci,
+    rssi: -55,
+    rssiNoise: 3,
+  }];
+  for (let i = 0; i < options.devices; i++) {
+    const suffix = (i + 2).toString(16).padStart(2, '0');
+    peripherals.push({
+      address: `c0:de:00:00:01:${suffix}`,
+      name: `other_${i}`,
+      serviceUuids: [],
+      advertInterval: options.advertInterval,
+      rssi: -70,
+      rssiNoise: 5,
+    });
+  }
+  return { seed: options.seed, peripherals };
+}
+
+function once(emitter, event) {
+  return new Promise(resolve => emitter.once(event, resolve));
+}
+
+async function main() {
+  const options = parseArgs(process.argv.slice(2));
+  const deviceModule = loadDeviceModule(options.module);
+  const logger = new Logger({ level: 'error' });
+
+  const samples = { scan: [], connect: [], reconnect: [] };
+
+  for (let run = 0; run < options.runs; run++) {
+    const device = new BleDevice({
+      macAddress: TARGET,
+      binding: 'simulator',
+      simulator: createScenario({ ...options, seed: options.seed + run }),
+    }, logger, deviceModule);
+
+    // Time to first compatible sighting
+    const noble = device.getNoble();
+    const scheduler = scanSchedulerFor(noble, logger);
+    let start = performance.now();
+    await new Promise((resolve) => {
+      const subscription = scheduler.subscribe({
+        filter: peripheral => peripheral.address === TARGET,
+        onDiscover: () => {
+          subscription.stop();
+          resolve();
+        },
+      });
+    });
+    samples.scan.push(performance.now() - start);
+
+    // Cold connect: connection plus service discovery and subscribe
+    start = performance.now();
+    await device.connect();
+    samples.connect.push(performance.now() - start);
+
+    // Reconnect after a link drop, reusing cached characteristics
+    const reconnected = once(device, 'connected');
+    start = performance.now();
+    noble.injectDisconnect(TARGET);
+    await reconnected;
+    samples.reconnect.push(performance.now() - start);
+
+    await device.destroy();
+  }
+
+  console.log(`${options.runs} runs, ${options.ci} ms connection interval, ` +
+    `${options.advertInterval} ms advert interval, ${options.devices} other advertisers`);
+  console.table([
+    summarize('scan (first sighting)', samples.scan),
+    summarize('connect (cold)', samples.connect),
+    summarize('reconnect (cached GATT)', samples.reconnect),
+  ]);
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
@@ -0,0 +1,148 @@
+/**
+ * BLE isolation latency benchmark.
+ *
+ * Measures BleDevice.write() latency (write with response, so every command
+ * waits for the device's acknowledgement) against the simulated adapter,
+ * with and without HTTP load on the main event loop, once with the BLE
+ * stack inline and once in a worker thread (ble.isolate). The load comes
+ * from a load generator thread hammering an HTTP server whose handler
+ * blocks the main loop for --handler-ms, like synchronous file I/O or a
+ * large JSON response would.
+ *
+ * Usage: node bench/isolation.js [--commands 200] [--interval 25] [--ci 30]
+ *                                [--handler-ms 5] [--concurrency 4] [--module btt-xg]
+ */
+
+const http = require('http');
+const { performance } = require('perf_hooks');
+const { Worker } = require('worker_threads');
+const { createBleDevice } = require('../lib/ble-device-proxy');
+const { loadDeviceModule } = require('../lib/device-loader');
+const { Logger } = require('../lib/logger');
+
+const ADDRESS = 'c0:de:00:00:00:01';
+
+// Keeps `concurrency` requests in flight until told to stop
+const LOAD_GENERATOR = `
+const http = require('http');
+const { parentPort, workerData } = require('worker_threads');
+const agent = new http.Agent({ keepAlive: true, maxSockets: workerData.concurrency });
+let running = true;
+let requests = 0;
+function next() {
+  if (!running) return;
+  http.get({ port: workerData.port, path: '/', agent }, (res) => {
+    res.resume();
+    res.on('end', () => { requests++; next(); });
+  }).on('error', () => setTimeout(next, 10));
+}
+for (let i = 0; i < workerData.concurrency; i++) next();
+parentPort.on('message', () => {
+  running = false;
+  agent.destroy();
+  parentPort.postMessage(requests);
+});
+`;
+
+function parseArgs(argv) {
+  const options = { commands: 200, interval: 25, ci: 30, handlerMs: 5, concurrency: 4, module: 'btt-xg' };
+  for (let i = 0; i < argv.length; i += 2) {
+    const key = argv[i].replace(/^--/, '').replace(/-(\w)/g, (_, c) => c.toUpperCase());
+    if (!(key in options)) throw new Error(`Unknown option: ${argv[i]}`);
+    options[key] = key === 'module' ? argv[i + 1] : Number(argv[i + 1]);
+  }
+  return options;
+}
+
+function percentile(sorted, p) {
+  return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+}
+
+function sleep(ms) {
+  return new Promise(resolve => setTimeout(resolve, ms));
+}
+
+function startServer(handlerMs) {
+  const server = http.createServer((req, res) => {
+    const until = performance.now() + handlerMs;
+    while (performance.now() < until) {
+      // blocks the event loop, as a synchronous handler does
+    }
+    res.end('ok');
+  });
+  return new Promise(resolve => server.listen(0, '127.0.0.1', () => resolve(server)));
+}
+
+async function run(isolate, load, deviceModule, options, port) {
+  const device = createBleDevice({
+    macAddress: ADDRESS,
+    writeMode: 'with-response',
+    binding: 'simulator',
+    simulator: { peripherals: [{ address: ADDRESS, connectionInterval: options.ci }] },
+    isolate,
+  }, new Logger({ level: 'error' }), deviceModule);
+
+  await device.connect();
+  while (!device.isConnected()) await sleep(10);
+  // Let the battery request sent on connect go out first
+  await sleep(2 * options.ci);
+
+  const loadGenerator = load
+    ? new Worker(LOAD_GENERATOR, { eval: true, workerData: { port, concurrency: options.concurrency } })
+    : null;
+  if (loadGenerator) await sleep(200);
+
+  const { buffer: command } = deviceModule.buildCommand({});
+  const latencies = [];
+  let failures = 0;
+  for (let i = 0; i < options.commands; i++) {
+    const startedAt = performance.now();
+    if (!await device.write(Buffer.from(command))) failures++;
+    latencies.push(performance.now() - startedAt);
+    await sleep(options.interval);
+  }
+
+  let requests = 0;
+  if (loadGenerator) {
+    requests = await new Promise((resolve) => {
+      loadGenerator.once('message', resolve);
+      loadGenerator.postMessage('stop');
+    });
+    await loadGenerator.terminate();
+  }
+  await device.destroy();
+
+  latencies.sort((a, b) => a - b);
+  return {
+    ble: isolate ? 'worker thread' : 'main thread',
+    'http load': load ? `${requests} requests` : 'none',
+    'p50 ms': percentile(latencies, 0.5).toFixed(1),
+    'p99 ms': percentile(latencies, 0.99).toFixed(1),
+    'max ms': latencies[latencies.length - 1].toFixed(1),
+    failures,
+  };
+}
+
+async function main() {
+  const options = parseArgs(process.argv.slice(2));
+  const deviceModule = loadDeviceModule(options.module);
+  const server = await startServer(options.handlerMs);
+  const { port } = server.address();
+
+  const rows = [];
+  for (const isolate of [false, true]) {
+    for (const load of [false, true]) {
+      rows.push(await run(isolate, load, deviceModule, options, port));
+    }
+  }
+  server.close();
+
+  console.log(`${options.commands} commands every ${options.interval} ms, ${options.ci} ms connection interval, ` +
+    `${options.concurrency} concurrent requests blocking ${options.handlerMs} ms each`);
+  console.table(rows);
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
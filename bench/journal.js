@@ -0,0 +1,97 @@
+/**
+ * Command journal benchmark.
+ *
+ * Measures the cost of CommandJournal.append() on the command path, the
+ * time to write the batches out, and range query latency over the
+ * resulting history. Runs in a temporary directory that is removed
+ * afterwards.
+ *
+ * Usage: node bench/journal.js [--records 200000] [--segment-size 1048576]
+ *                              [--queries 50] [--span 1000]
+ *
+ * --span is the number of consecutive records each range query returns.
+ */
+
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { performance } = require('perf_hooks');
+const { CommandJournal } = require('../lib/command-journal');
+const { Logger } = require('../lib/logger');
+const { WriteResult } = require('../lib/constants');
+
+function parseArgs(argv) {
+  const options = { records: 200000, segmentSize: 1048576, queries: 50, span: 1000 };
+  for (let i = 0; i < argv.length; i += 2) {
+    const key = argv[i].replace(/^--/, '').replace(/-(\w)/g, (_, c) => c.toUpperCase());
+    if (!(key in options)) throw new Error(`Unknown option: ${argv[i]}`);
+    options[key] = Number(argv[i + 1]);
+  }
+  return options;
+}
+
+function percentile(sorted, p) {
+  return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+}
+
+async function main() {
+  const options = parseArgs(process.argv.slice(2));
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'journal-bench-'));
+  const journal = new CommandJournal({
+    dir,
+    controlIds: ['shock', 'vibro', 'sound', 'find'],
+    segmentSize: options.segmentSize,
+  }, new Logger({ level: 'error' }));
+
+  try {
+    // Spread records over time so range queries have something to select
+    const realNow = Date.now;
+    const base = realNow();
+    let fakeTime = base;
+    Date.now = () => fakeTime;
+
+    const originators = ['192.168.1.20', '192.168.1.21', '::ffff:10.0.0.5'];
+    const start = performance.now();
+    for (let i = 0; i < options.records; i++) {
+      fakeTime = base + i * 10;
+      journal.append(originators[i % 3], { shock: i % 100, vibro: 20 }, i % 4 ? 'local' : 'node-1', 12.5, WriteResult.WRITTEN);
+    }
+    const appendMs = performance.now() - start;
+    Date.now = realNow;
+
+    const flushStart = performance.now();
+    await journal.flush();
+    const flushMs = performance.now() - flushStart;
+    const stats = journal.getStats();
+
+    const latencies = [];
+    for (let q = 0; q < options.queries; q++) {
+      const first = Math.floor(Math.random() * Math.max(1, options.records - options.span));
+      const from = base + first * 10;
+      const queryStart = performance.now();
+      const { records } = await journal.query(from, from + (options.span - 1) * 10, options.span);
+      latencies.push(performance.now() - queryStart);
+      if (records.length !== Math.min(options.span, options.records)) {
+        throw new Error(`Query returned ${records.length} records, expected ${options.span}`);
+      }
+    }
+    latencies.sort((a, b) => a - b);
+
+    console.log(`${options.records} records in ${stats.segments} segments, ${(stats.bytes / 1024).toFixed(0)} KiB ` +
+      `(${(stats.bytes / options.records).toFixed(1)} bytes/record)`);
+    console.table([{
+      'append ns/record': ((appendMs * 1e6) / options.records).toFixed(0),
+      'write-out ms': flushMs.toFixed(1),
+      [`query p50 ms (${options.span})`]: percentile(latencies, 0.5).toFixed(2),
+      'query p99 ms': percentile(latencies, 0.99).toFixed(2),
+    }]);
+  } finally {
+    await journal.close();
+    fs.rmSync(dir, { recursive: true, force: true });
+  }
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
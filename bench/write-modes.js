@@ -0,0 +1,107 @@
+/**
+ * Write mode throughput benchmark.
+ *
+ * Connects a BleDevice to the simulated adapter (lib/sim-noble.js) and reports
+ * throughput, delivery latency and loss of BleDevice.write() for each write
+ * mode. The simulated link drains a few packets per connection event;
+ * write-without-response packets go into a small controller buffer and are
+ * silently dropped when it is full, write-with-response resolves once the
+ * device has acknowledged the packet.
+ *
+ * Usage: node bench/write-modes.js [--writes 200] [--ci 30] [--per-event 4]
+ *                                  [--buffer 6] [--interval 0] [--module btt-xg]
+ *
+ * --interval 0 writes back to back (worst case); a positive value paces writes
+ * like the write scheduler does.
+ */
+
+const { performance } = require('perf_hooks');
+const { BleDevice } = require('../lib/ble-device');
+const { loadDeviceModule, WRITE_MODES } = require('../lib/device-loader');
+const { Logger } = require('../lib/logger');
+
+function parseArgs(argv) {
+  const options = { writes: 200, ci: 30, perEvent: 4, buffer: 6, interval: 0, module: 'btt-xg' };
+  for (let i = 0; i < argv.length; i += 2) {
+    const key = argv[i].replace(/^--/, '').replace(/-(\w)/g, (_, c) => c.toUpperCase());
+    if (!(key in options)) throw new Error(`Unknown option: ${argv[i]}`);
+    options[key] = key === 'module' ? argv[i + 1] : Number(argv[i + 1]);
+  }
+  return options;
+}
+
+function percentile(sorted, p) {
+  if (sorted.length === 0) return 0;
+  return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+}
+
+async function runMode(writeMode, deviceModule, options) {
+  const address = 'c0:de:00:00:00:01';
+  const device = new BleDevice({
+    macAddress: address,
+    writeMode,
+    binding: 'simulator',
+    simulator: {
+      peripherals: [{
+        address,
+        connectionInterval: options.ci,
+        packetsPerEvent: options.perEvent,
+        writeBuffer: options.buffer,
+      }],
+    },
+  }, new Logger({ level: 'error' }), deviceModule);
+
+  await device.connect();
+  // Let the battery request sent on connect go out first
+  await new Promise(resolve => setTimeout(resolve, 2 * options.ci));
+  const peripheral = device.getNoble().getPeripheral(address);
+  const latencies = [];
+  peripheral.on('packet', (data, latency) => latencies.push(latency));
+
+  const { buffer } = deviceModule.buildCommand({ vibro: 10 });
+  const start = performance.now();
+  for (let i = 0; i < options.writes; i++) {
+    await device.write(buffer);
+    if (options.interval > 0) await new Promise(resolve => setTimeout(resolve, options.interval));
+  }
+
+  // Let the link drain what is still buffered
+  while (peripheral._queue.length > 0) {
+    await new Promise(resolve => setTimeout(resolve, options.ci));
+  }
+  const elapsed = (performance.now() - start) / 1000;
+  await device.destroy();
+
+  latencies.sort((a, b) => a - b);
+  const { dropped } = peripheral.stats;
+  return {
+    mode: writeMode,
+    'writes/s': Math.round(latencies.length / elapsed),
+    'p50 ms': percentile(latencies, 0.5).toFixed(1),
+    'p95 ms': percentile(latencies, 0.95).toFixed(1),
+    'p99 ms': percentile(latencies, 0.99).toFixed(1),
+    delivered: latencies.length,
+    lost: dropped,
+    'loss %': ((dropped / options.writes) * 100).toFixed(1),
+  };
+}
+
+async function main() {
+  const options = parseArgs(process.argv.slice(2));
+  const deviceModule = loadDeviceModule(options.module);
+
+  console.log(`${options.writes} writes, ${options.ci} ms connection interval, ` +
+    `${options.perEvent} packets/event, buffer ${options.buffer}, ` +
+    (options.interval > 0 ? `paced every ${options.interval} ms` : 'back to back'));
+
+  const results = [];
+  for (const mode of WRITE_MODES) {
+    results.push(await runMode(mode, deviceModule, options));
+  }
+  console.table(results);
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
@@ -41,8 +41,13 @@ module.exports = {
     };
   },
 
-  buildBatteryRequest() {
-    return Buffer.from([0xDD, 0xAA, 0xBB]);
+  // Requests answered by a notification: `match` picks the answer out of
+  // parseNotification() results
+  requests: {
+    battery: {
+      build: () => Buffer.from([0xDD, 0xAA, 0xBB]),
+      match: result => result.type === 'battery',
+    },
   },
 
   parseNotification(data) {
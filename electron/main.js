@@ -9,6 +9,8 @@ const appRoot = path.join(__dirname, '..');
 const userDataPath = app.getPath('userData');
 const configPath = path.join(userDataPath, 'config.json');
 const kvStoragePath = path.join(userDataPath, 'kvStorage.json');
+const journalPath = path.join(userDataPath, 'journal');
+const discoveryCachePath = path.join(userDataPath, 'discovery-cache.json');
 const configExamplePath = path.join(appRoot, 'config.example.json');
 
 let mainWindow = null;
@@ -102,6 +104,8 @@ function startServer() {
       ...process.env,
       CONFIG_PATH: configPath,
       KV_STORAGE_PATH: kvStoragePath,
+      JOURNAL_PATH: journalPath,
+      DISCOVERY_CACHE_PATH: discoveryCachePath,
       ELECTRON: '1',
     },
     silent: true,
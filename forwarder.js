@@ -9,27 +9,43 @@
 
 const fs = require('fs');
 const path = require('path');
+const { performance } = require('perf_hooks');
+const http = require('http');
 const WebSocket = require('ws');
 
 const { Logger } = require('./lib/logger');
 const { loadDeviceModule } = require('./lib/device-loader');
-const { BleDevice } = require('./lib/ble-device');
+const { createBleDevice } = require('./lib/ble-device-proxy');
+const { WriteScheduler } = require('./lib/write-scheduler');
+const { WriteResult } = require('./lib/constants');
+const { planCommand } = require('./lib/sequence-engine');
+const { registry: metricsRegistry } = require('./lib/metrics');
 const {
   MSG_AUTH,
   MSG_AUTH_RESULT,
   MSG_STATUS,
   MSG_SCAN_RESULT,
+  MSG_SCAN_SIGHTING,
   MSG_BATTERY,
   MSG_RSSI,
+  MSG_RSSI_SAMPLE,
   MSG_COMMAND,
+  MSG_SEQUENCE,
+  MSG_COMMAND_SPEC,
   MSG_COMMAND_RESULT,
   MSG_GET_BATTERY,
   MSG_GET_RSSI,
   MSG_SCAN,
+  MSG_SCAN_CANCEL,
   MSG_CONNECT,
   MSG_DISCONNECT_BLE,
-  parseMessage,
+  CAP_BINARY,
+  CAP_RESULT_CODE,
+  SUPPORTED_CAPABILITIES,
   formatMessage,
+  formatBinaryMessage,
+  hasBinaryForm,
+  decodeFrame,
 } = require('./lib/node-protocol');
 
 // Load configuration
@@ -56,33 +72,83 @@ try {
 }
 
 // Initialize logger
-const logger = new Logger({ level: config.logging?.level || 'info' });
+const logger = new Logger({
+  level: config.logging?.level || 'info',
+  format: config.logging?.format,
+  file: config.logging?.file,
+  levels: config.logging?.levels,
+  ringSize: config.logging?.ringSize,
+});
 const mainLogger = logger.child('forwarder');
 
 mainLogger.info(`Loaded device module: ${deviceModule.displayName}`);
 
 // Initialize BLE device
-const bleDevice = new BleDevice({
+const bleDevice = createBleDevice({
   macAddress: config.device?.macAddress,
   addressType: config.device?.addressType,
   hciInterface: config.ble?.hciInterface,
   reconnectDelay: config.ble?.reconnectDelay,
+  reconnectBaseDelay: config.ble?.reconnectBaseDelay,
   deviceNamePatterns: config.ble?.deviceNamePatterns,
   scanDuration: config.ble?.scanDuration,
+  scanMaxDevices: config.ble?.scanMaxDevices,
+  scanDeviceTtl: config.ble?.scanDeviceTtl,
+  writeMode: config.ble?.writeMode,
+  writeBarrierEvery: config.ble?.writeBarrierEvery,
+  binding: config.ble?.binding,
+  simulator: config.ble?.simulator,
+  isolate: config.ble?.isolate,
+  discoveryCache: config.ble?.discoveryCache === false ? ''
+    : config.ble?.discoveryCachePath || path.join(__dirname, 'discovery-cache.json'),
+  discoveryCacheTtl: config.ble?.discoveryCacheTtl,
+  requestTimeout: config.ble?.requestTimeout,
 }, logger, deviceModule);
 
+// Local write queue: sequences (repeats, holds) run here, not over the network
+const writeScheduler = new WriteScheduler({
+  writeInterval: config.ble?.writeInterval,
+  maxQueue: config.ble?.writeQueueLimit,
+}, (data) => bleDevice.write(data), logger);
+
 // WebSocket connection state
 let ws = null;
 let reconnectDelay = 1000;
 const MAX_RECONNECT_DELAY = 30000;
 let statusInterval = null;
+let binaryFraming = false;
+let resultCodes = false; // command_result may say superseded/dropped, not just failed
+
+// Commands run in order through the write queue; results are acknowledged in ranges
+const MAX_ACK_RANGE = 32;
+let queuedCommands = 0;
+let pendingAck = null; // { from, to, result, nodeUs }
+
+// Aborts the running handoff or standby RSSI scan, if any
+let scanAbort = null;
+let connectInProgress = false;
+
+// Low-duty-cycle RSSI tracking for proactive handoff (0 disables)
+const RSSI_INTERVAL = config.node.rssiInterval ?? 5000;
+const RSSI_SCAN_WINDOW = config.node.rssiScanWindow || 500;
+let rssiTimer = null;
+
+// Binary framing can be disabled for debugging with node.binaryFraming: false
+const requestedCapabilities = config.node.binaryFraming === false
+  ? SUPPORTED_CAPABILITIES.filter(cap => cap !== CAP_BINARY)
+  : SUPPORTED_CAPABILITIES;
 
 /**
  * Send a message to the server.
+ * Uses a binary frame when negotiated and the type has one.
  */
 function send(type, payload = {}) {
   if (ws && ws.readyState === WebSocket.OPEN) {
-    ws.send(formatMessage(type, payload));
+    if (binaryFraming && hasBinaryForm(type)) {
+      ws.send(formatBinaryMessage(type, payload));
+    } else {
+      ws.send(formatMessage(type, payload));
+    }
   }
 }
 
@@ -108,26 +174,34 @@ function connectToServer() {
   ws.on('open', () => {
     mainLogger.info('Connected to server, authenticating...');
     reconnectDelay = 1000; // Reset backoff
+    binaryFraming = false;
+    resultCodes = false;
 
     // Authenticate
     send(MSG_AUTH, {
       token: config.node.token || '',
       nodeId: config.node.id || `node-${require('os').hostname()}`,
+      capabilities: requestedCapabilities,
+      deviceModule: deviceModule.name,
     });
   });
 
-  ws.on('message', (raw) => {
-    const msg = parseMessage(raw.toString());
+  ws.on('message', (raw, isBinary) => {
+    const msg = decodeFrame(raw, isBinary);
     if (!msg) return;
 
     switch (msg.type) {
       case MSG_AUTH_RESULT:
         if (msg.success) {
-          mainLogger.info('Authenticated successfully');
+          // Servers without capability support omit the field: stay on JSON
+          binaryFraming = Array.isArray(msg.capabilities) && msg.capabilities.includes(CAP_BINARY);
+          resultCodes = Array.isArray(msg.capabilities) && msg.capabilities.includes(CAP_RESULT_CODE);
+          mainLogger.info('Authenticated successfully', { binaryFraming });
           // Start periodic status updates
           if (statusInterval) clearInterval(statusInterval);
           statusInterval = setInterval(sendStatus, 10000);
           sendStatus();
+          scheduleRssiSample();
         } else {
           mainLogger.error('Authentication failed');
           ws.close();
@@ -138,12 +212,19 @@ function connectToServer() {
         handleCommand(msg);
         break;
 
+      case MSG_SEQUENCE:
+        handleSequence(msg);
+        break;
+
+      case MSG_COMMAND_SPEC:
+        handleCommandSpec(msg);
+        break;
+
       case MSG_GET_BATTERY:
-        bleDevice.requestBattery();
-        // Battery result arrives via event, send current known value immediately
-        setTimeout(() => {
-          send(MSG_BATTERY, { level: bleDevice.getBatteryLevel() });
-        }, 1000);
+        // An answer reaches the server through the 'battery' event; without one, send the last known level
+        bleDevice.readBattery().then((level) => {
+          if (level === null) send(MSG_BATTERY, { level: bleDevice.getBatteryLevel() });
+        });
         break;
 
       case MSG_GET_RSSI:
@@ -154,6 +235,10 @@ function connectToServer() {
         handleScan(msg.duration);
         break;
 
+      case MSG_SCAN_CANCEL:
+        cancelScan();
+        break;
+
       case MSG_CONNECT:
         handleConnect();
         break;
@@ -170,6 +255,7 @@ function connectToServer() {
       clearInterval(statusInterval);
       statusInterval = null;
     }
+    stopRssiSampling();
     scheduleReconnect();
   });
 
@@ -189,11 +275,93 @@ function scheduleReconnect() {
 
 /**
  * Handle a command from the server.
+ * Commands are written in arrival order. While more commands are queued
+ * behind this one, results are held back and merged into a single
+ * command_result covering a contiguous id range.
+ */
+function handleCommand(msg) {
+  const receivedAt = performance.now();
+  // Binary frames carry the raw buffer, JSON frames a hex string
+  const data = Buffer.isBuffer(msg.data) ? msg.data : Buffer.from(msg.data, 'hex');
+  submitCommand(msg, [{ buffer: data, offset: 0 }], false, receivedAt);
+}
+
+/**
+ * Handle a timed command sequence from the server.
+ * The steps run on the local write queue, so repeats do not cross the
+ * network; the single ack carries the result of the first write.
+ */
+function handleSequence(msg) {
+  const receivedAt = performance.now();
+  const steps = (msg.steps || []).map(step => ({
+    buffer: Buffer.from(step.data, 'hex'),
+    offset: step.offset || 0,
+  }));
+  submitCommand(msg, steps, !!msg.coalesce, receivedAt);
+}
+
+/**
+ * Handle control values from the server.
+ * The command is built and timed locally with the device module, so the
+ * server sends one small message and gets one ack per command.
+ */
+function handleCommandSpec(msg) {
+  const receivedAt = performance.now();
+  let steps = [];
+  try {
+    steps = planCommand(deviceModule.buildCommand(msg.values || {}));
+  } catch (err) {
+    mainLogger.error('Failed to build command', { error: err.message });
+  }
+  submitCommand(msg, steps, !!msg.coalesce, receivedAt);
+}
+
+/**
+ * Queue steps for writing and acknowledge the command when the first write
+ * completes, reporting the time from receipt to that write for latency tracing.
+ */
+function submitCommand(msg, steps, coalesce, receivedAt) {
+  if (msg.trace) mainLogger.debug('Command received', { id: msg.id, trace: msg.trace });
+  queuedCommands++;
+  writeScheduler.submit(steps, { coalesce }).then((result) => {
+    queuedCommands--;
+    recordCommandResult(msg.id, result, Math.round((performance.now() - receivedAt) * 1000));
+  });
+}
+
+/**
+ * Merge a command result into the pending ack range, flushing when the
+ * range cannot be extended or nothing else is queued.
+ */
+function recordCommandResult(id, result, nodeUs) {
+  if (pendingAck && (id !== pendingAck.to + 1 || result !== pendingAck.result)) {
+    flushCommandAck();
+  }
+
+  if (pendingAck) {
+    pendingAck.to = id;
+    pendingAck.nodeUs = nodeUs;
+  } else {
+    pendingAck = { from: id, to: id, result, nodeUs };
+  }
+
+  if (queuedCommands === 0 || pendingAck.to - pendingAck.from + 1 >= MAX_ACK_RANGE) {
+    flushCommandAck();
+  }
+}
+
+/**
+ * Send the pending ack range, if any. Servers without result_code only
+ * learn whether the write succeeded.
  */
-async function handleCommand(msg) {
-  const data = Buffer.from(msg.data, 'hex');
-  const success = await bleDevice.write(data);
-  send(MSG_COMMAND_RESULT, { id: msg.id, success });
+function flushCommandAck() {
+  if (!pendingAck) return;
+  const { from, to, result, nodeUs } = pendingAck;
+  pendingAck = null;
+  const ack = { id: to, success: result === WriteResult.WRITTEN, nodeUs };
+  if (from !== to) ack.from = from;
+  if (resultCodes) ack.result = result;
+  send(MSG_COMMAND_RESULT, ack);
 }
 
 /**
@@ -206,17 +374,100 @@ async function handleGetRssi() {
   }
 }
 
+/**
+ * Schedule the next RSSI sample.
+ */
+function scheduleRssiSample() {
+  if (!RSSI_INTERVAL) return;
+  stopRssiSampling();
+  rssiTimer = setTimeout(async () => {
+    try {
+      await sampleRssi();
+    } catch (err) {
+      mainLogger.debug('RSSI sample failed', { error: err.message });
+    }
+    if (rssiTimer) scheduleRssiSample();
+  }, RSSI_INTERVAL);
+}
+
+/**
+ * Stop RSSI sampling.
+ */
+function stopRssiSampling() {
+  if (rssiTimer) {
+    clearTimeout(rssiTimer);
+    rssiTimer = null;
+  }
+}
+
+/**
+ * Take one RSSI sample and stream it to the server.
+ * While connected the link RSSI is read; on standby a short scan window
+ * looks for the target's adverts, matched by device.macAddress. Without a
+ * configured address the strongest compatible device is reported. Standby
+ * sampling yields to handoff scans and connects, and is aborted by them.
+ */
+async function sampleRssi() {
+  if (bleDevice.isConnected()) {
+    const rssi = await bleDevice.getRssi();
+    if (rssi !== null) send(MSG_RSSI_SAMPLE, { value: rssi, source: 'link' });
+    return;
+  }
+
+  if (scanAbort || connectInProgress) return;
+
+  const target = config.device?.macAddress?.toLowerCase();
+  const abort = new AbortController();
+  scanAbort = abort;
+  let best = null;
+  try {
+    await bleDevice.scan(RSSI_SCAN_WINDOW, {
+      quiet: true,
+      signal: abort.signal,
+      onDevice: (device) => {
+        if (target && device.address?.toLowerCase() !== target) return;
+        if (best === null || device.rssi > best) best = device.rssi;
+      },
+    });
+  } finally {
+    if (scanAbort === abort) scanAbort = null;
+  }
+
+  if (best !== null) send(MSG_RSSI_SAMPLE, { value: best, source: 'advert' });
+}
+
 /**
  * Handle a scan request from the server (for handoff election).
+ * Each sighting is streamed as it happens so the server can elect early.
  */
 async function handleScan(duration) {
   mainLogger.info(`Scanning for ${(duration || 10000) / 1000}s (handoff)...`);
+  cancelScan();
+  const abort = new AbortController();
+  scanAbort = abort;
+
   try {
-    const devices = await bleDevice.scan(duration);
-    send(MSG_SCAN_RESULT, { devices });
+    const devices = await bleDevice.scan(duration, {
+      signal: abort.signal,
+      onDevice: (device) => send(MSG_SCAN_SIGHTING, { address: device.address, rssi: device.rssi }),
+    });
+    // A cancelled scan's result is no longer wanted by the server
+    if (!abort.signal.aborted) send(MSG_SCAN_RESULT, { devices });
   } catch (err) {
     mainLogger.error('Scan failed', { error: err.message });
     send(MSG_SCAN_RESULT, { devices: [] });
+  } finally {
+    if (scanAbort === abort) scanAbort = null;
+  }
+}
+
+/**
+ * Stop the running handoff scan early.
+ */
+function cancelScan() {
+  if (scanAbort) {
+    scanAbort.abort();
+    scanAbort = null;
   }
 }
 
@@ -225,10 +476,14 @@ async function handleScan(duration) {
  */
 async function handleConnect() {
   mainLogger.info('Server requested BLE connect');
+  cancelScan();
+  connectInProgress = true;
   try {
     await bleDevice.connect();
   } catch (err) {
     mainLogger.error('BLE connect failed', { error: err.message });
+  } finally {
+    connectInProgress = false;
   }
 }
 
@@ -260,11 +515,32 @@ bleDevice.on('battery', (level) => {
 process.on('SIGINT', async () => {
   mainLogger.info('Shutting down...');
   if (statusInterval) clearInterval(statusInterval);
+  stopRssiSampling();
+  writeScheduler.clear();
   if (ws) ws.close();
   await bleDevice.destroy();
   process.exit();
 });
 
+// Optional Prometheus endpoint (node.metricsPort), for monitoring a fleet of forwarders
+metricsRegistry.gauge('forwarder_server_connected', 'Whether the node is connected to the server (1) or not (0)')
+  .collect(() => (ws && ws.readyState === WebSocket.OPEN ? 1 : 0));
+metricsRegistry.gauge('forwarder_queued_commands', 'Commands waiting for their first write')
+  .collect(() => queuedCommands);
+
+if (config.node.metricsPort) {
+  http.createServer((req, res) => {
+    if (req.url !== '/metrics') {
+      res.writeHead(404).end();
+      return;
+    }
+    res.writeHead(200, { 'Content-Type': metricsRegistry.contentType });
+    res.end(metricsRegistry.render());
+  }).listen(config.node.metricsPort, () => {
+    mainLogger.info(`Metrics available on port ${config.node.metricsPort} at /metrics`);
+  });
+}
+
 // Start
 mainLogger.info(`Forwarder node: ${config.node.id || 'auto'}`);
 connectToServer();
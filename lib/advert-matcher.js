@@ -0,0 +1,115 @@
+/**
+ * Compiled advertisement matcher.
+ *
+ * Decides whether an advert belongs to a compatible device: by service UUID
+ * (a Set lookup) or by a case-insensitive substring of the local name (all
+ * patterns compiled into one regex). Results are cached per peripheral and
+ * reused while its name and service UUID list are unchanged, so repeated
+ * reports from known devices skip matching entirely. Names often arrive
+ * only in the scan response, which is why the cache entry is checked
+ * against the current advert rather than trusted blindly.
+ */
+
+const MATCH_SERVICE = 'service-uuid';
+const MATCH_NAME = 'name-pattern';
+const MATCH_NONE = 'none';
+
+/**
+ * Normalize a UUID to noble's format (lowercase, no dashes).
+ * @param {string} uuid
+ * @returns {string}
+ */
+function normalizeUuid(uuid) {
+  return String(uuid).toLowerCase().replace(/-/g, '');
+}
+
+function escapeRegExp(text) {
+  return text.replace(/[.*+?^${}()|[\]\\]/g, '\\$&');
+}
+
+function sameUuids(cached, current) {
+  if (!current || current.length === 0) return !cached || cached.length === 0;
+  if (!cached || cached.length !== current.length) return false;
+  for (let i = 0; i < current.length; i++) {
+    if (cached[i] !== current[i]) return false;
+  }
+  return true;
+}
+
+class AdvertMatcher {
+  /**
+   * @param {Object} options
+   * @param {string[]} [options.serviceUuids=[]] - Service UUIDs that identify the device
+   * @param {string[]} [options.namePatterns=[]] - Case-insensitive local name substrings
+   * @param {number} [options.cacheSize=1024] - Peripherals whose result is remembered
+   */
+  constructor(options = {}) {
+    this._serviceUuids = new Set((options.serviceUuids || []).filter(Boolean).map(normalizeUuid));
+    const patterns = (options.namePatterns || []).filter(pattern => pattern && pattern.length > 0);
+    this._nameRegex = patterns.length > 0 ? new RegExp(patterns.map(escapeRegExp).join('|'), 'i') : null;
+    this._cacheSize = options.cacheSize ?? 1024;
+    this._cache = new Map(); // peripheral id -> { name, serviceUuids (copy), result }
+    this._stats = { hits: 0, misses: 0 };
+  }
+
+  /**
+   * Classify an advert.
+   * @param {Object} peripheral - Noble peripheral from a 'discover' event
+   * @returns {string} 'service-uuid', 'name-pattern' or 'none'
+   */
+  match(peripheral) {
+    const advertisement = peripheral.advertisement;
+    const name = advertisement?.localName;
+    const serviceUuids = advertisement?.serviceUuids;
+    const key = peripheral.id || peripheral.address;
+
+    if (key && this._cacheSize > 0) {
+      const entry = this._cache.get(key);
+      if (entry !== undefined && entry.name === name && sameUuids(entry.serviceUuids, serviceUuids)) {
+        this._stats.hits++;
+        return entry.result;
+      }
+    }
+
+    this._stats.misses++;
+    const result = this._classify(name, serviceUuids);
+    if (key && this._cacheSize > 0) {
+      if (this._cache.size >= this._cacheSize && !this._cache.has(key)) {
+        // Oldest first: rotating random addresses age out
+        this._cache.delete(this._cache.keys().next().value);
+      }
+      // noble may update the advert in place: keep a copy to compare against
+      this._cache.set(key, { name, serviceUuids: serviceUuids ? serviceUuids.slice() : null, result });
+    }
+    return result;
+  }
+
+  /**
+   * Whether an advert belongs to a compatible device.
+   * @param {Object} peripheral
+   * @returns {boolean}
+   */
+  matches(peripheral) {
+    return this.match(peripheral) !== MATCH_NONE;
+  }
+
+  /**
+   * Cache counters, for diagnostics and the benchmark.
+   * @returns {{ hits: number, misses: number, cached: number }}
+   */
+  getStats() {
+    return { ...this._stats, cached: this._cache.size };
+  }
+
+  _classify(name, serviceUuids) {
+    if (serviceUuids && this._serviceUuids.size > 0) {
+      for (let i = 0; i < serviceUuids.length; i++) {
+        if (this._serviceUuids.has(serviceUuids[i])) return MATCH_SERVICE;
+      }
+    }
+    if (name && this._nameRegex !== null && this._nameRegex.test(name)) return MATCH_NAME;
+    return MATCH_NONE;
+  }
+}
+
+module.exports = { AdvertMatcher, normalizeUuid, MATCH_SERVICE, MATCH_NAME, MATCH_NONE };
@@ -0,0 +1,91 @@
+/**
+ * Crash-safe file replacement.
+ *
+ * Data is written to a temporary file next to the target, fsynced, and then
+ * renamed over the target, so readers see either the old or the new
+ * content, never a partial write. The directory is fsynced afterwards
+ * (where the platform allows it) so the rename itself survives a power loss.
+ */
+
+const fs = require('fs');
+const path = require('path');
+
+let tmpCounter = 0;
+
+function tmpPathFor(filePath) {
+  return `${filePath}.${process.pid}.${++tmpCounter}.tmp`;
+}
+
+/**
+ * Atomically replace a file's content.
+ * @param {string} filePath - Target file
+ * @param {string|Buffer} data - New content
+ * @returns {Promise<void>}
+ */
+async function writeFileAtomic(filePath, data) {
+  const tmpPath = tmpPathFor(filePath);
+  let handle = null;
+  try {
+    handle = await fs.promises.open(tmpPath, 'w');
+    await handle.writeFile(data);
+    await handle.sync();
+    await handle.close();
+    handle = null;
+    await fs.promises.rename(tmpPath, filePath);
+  } catch (err) {
+    if (handle) await handle.close().catch(() => {});
+    await fs.promises.unlink(tmpPath).catch(() => {});
+    throw err;
+  }
+  await syncDirectory(path.dirname(filePath));
+}
+
+/**
+ * Synchronous variant for startup and shutdown paths.
+ * @param {string} filePath - Target file
+ * @param {string|Buffer} data - New content
+ */
+function writeFileAtomicSync(filePath, data) {
+  const tmpPath = tmpPathFor(filePath);
+  let fd = null;
+  try {
+    fd = fs.openSync(tmpPath, 'w');
+    fs.writeFileSync(fd, data);
+    fs.fsyncSync(fd);
+    fs.closeSync(fd);
+    fd = null;
+    fs.renameSync(tmpPath, filePath);
+  } catch (err) {
+    if (fd !== null) fs.closeSync(fd);
+    try {
+      fs.unlinkSync(tmpPath);
+    } catch {
+      // already gone
+    }
+    throw err;
+  }
+  try {
+    const dirFd = fs.openSync(path.dirname(filePath), 'r');
+    try {
+      fs.fsyncSync(dirFd);
+    } finally {
+      fs.closeSync(dirFd);
+    }
+  } catch {
+    // directories cannot be fsynced on some platforms (Windows)
+  }
+}
+
+async function syncDirectory(dir) {
+  let handle = null;
+  try {
+    handle = await fs.promises.open(dir, 'r');
+    await handle.sync();
+  } catch {
+    // directories cannot be fsynced on some platforms (Windows)
+  } finally {
+    if (handle) await handle.close().catch(() => {});
+  }
+}
+
+module.exports = { writeFileAtomic, writeFileAtomicSync };
@@ -0,0 +1,303 @@
+/**
+ * BleDevice running in a worker thread (ble.isolate).
+ *
+ * noble's HCI bindings, BleDevice and the scanner run in lib/ble-worker.js,
+ * so slow HTTP, Socket.io or file I/O handlers on the main event loop no
+ * longer delay BLE event processing, and advert storms no longer delay
+ * HTTP. BleDeviceProxy has BleDevice's interface: calls become messages,
+ * write payloads are copied once into a buffer whose ownership is
+ * transferred to the worker, and connection state and battery level are
+ * mirrored from the worker so isConnected() and getBatteryLevel() stay
+ * synchronous. The worker's log records and metrics are merged into the
+ * main thread's logger and registry.
+ *
+ * If the worker dies it is restarted, and reconnects if a connection had
+ * been requested.
+ */
+
+const path = require('path');
+const { EventEmitter } = require('events');
+const { Worker } = require('worker_threads');
+const { BleDevice } = require('./ble-device');
+const { DeviceTable } = require('./device-table');
+const { registry } = require('./metrics');
+
+const WORKER_PATH = path.join(__dirname, 'ble-worker.js');
+const RESTART_DELAY = 1000;
+
+class BleDeviceProxy extends EventEmitter {
+  /**
+   * @param {Object} config - BleDevice config
+   * @param {Object} logger - Logger instance; the worker's records are added to it
+   * @param {Object} deviceModule - Device module from loadDeviceModule(); loaded again by name in the worker
+   */
+  constructor(config, logger, deviceModule) {
+    super();
+    this._config = config;
+    this._logger = logger;
+    this._bleLogger = logger.child('ble');
+    this._moduleName = deviceModule._moduleName;
+
+    this._worker = null;
+    this._nextId = 1;
+    this._pending = new Map(); // message id -> { resolve, reject, onEntry }
+    this._tableIds = new WeakMap(); // DeviceTable -> id of its copy in the worker
+    this._nextTableId = 1;
+    this._connected = false;
+    this._batteryLevel = 100;
+    this._wantConnected = false;
+    this._destroyed = false;
+    this._metricsText = '';
+    this._removeMetrics = registry.include(() => this._metricsText);
+
+    this._startWorker();
+  }
+
+  _startWorker() {
+    const worker = new Worker(WORKER_PATH, {
+      workerData: {
+        config: this._config,
+        moduleName: this._moduleName,
+        logger: this._logger.remoteOptions(),
+      },
+    });
+    this._worker = worker;
+    worker.on('message', msg => this._onMessage(msg));
+    worker.on('error', (err) => {
+      this._bleLogger.error('BLE worker failed', { error: err.message });
+    });
+    worker.on('exit', code => this._onExit(worker, code));
+  }
+
+  _onMessage(msg) {
+    switch (msg.type) {
+      case 'result': {
+        const pending = this._pending.get(msg.id);
+        if (!pending) return;
+        this._pending.delete(msg.id);
+        if (msg.error !== undefined) pending.reject(new Error(msg.error));
+        else pending.resolve(msg.value);
+        break;
+      }
+      case 'state':
+        this._connected = msg.connected;
+        this._batteryLevel = msg.batteryLevel;
+        break;
+      case 'event':
+        this.emit(msg.name, ...msg.args);
+        break;
+      case 'scan:device':
+        this._pending.get(msg.id)?.onEntry?.(msg.entry);
+        break;
+      case 'log':
+        this._logger.append(msg.records);
+        break;
+      case 'metrics':
+        this._metricsText = msg.text;
+        break;
+    }
+  }
+
+  _onExit(worker, code) {
+    if (worker !== this._worker) return;
+    this._worker = null;
+    const error = new Error(`BLE worker exited with code ${code}`);
+    for (const pending of this._pending.values()) pending.reject(error);
+    this._pending.clear();
+    if (this._connected) {
+      this._connected = false;
+      this.emit('disconnected');
+    }
+    if (this._destroyed) return;
+
+    this._bleLogger.error('BLE worker exited, restarting', { code, delay: RESTART_DELAY });
+    setTimeout(() => {
+      if (this._destroyed) return;
+      this._startWorker();
+      if (this._wantConnected) this.connect();
+    }, RESTART_DELAY);
+  }
+
+  _request(msg, transfer, onEntry, id = this._nextId++) {
+    if (!this._worker) return Promise.reject(new Error('BLE worker not running'));
+    return new Promise((resolve, reject) => {
+      this._pending.set(id, { resolve, reject, onEntry });
+      this._worker.postMessage({ ...msg, id }, transfer);
+    });
+  }
+
+  _call(method, ...args) {
+    return this._request({ type: 'call', method, args });
+  }
+
+  /**
+   * Connect to the device, see BleDevice.connect().
+   */
+  async connect() {
+    this._wantConnected = true;
+    await this._call('connect');
+  }
+
+  /**
+   * Disconnect without auto-reconnect, see BleDevice.disconnect().
+   */
+  async disconnect() {
+    this._wantConnected = false;
+    await this._call('disconnect');
+  }
+
+  /**
+   * @returns {boolean} Whether the device is connected and ready, as last reported by the worker
+   */
+  isConnected() {
+    return this._connected;
+  }
+
+  /**
+   * Write to the TX characteristic, see BleDevice.write().
+   * @param {Buffer} data
+   * @returns {Promise<boolean>}
+   */
+  async write(data) {
+    if (!this._connected) {
+      this._bleLogger.warn('Cannot write: device not connected');
+      return false;
+    }
+    // Buffers may be views into a shared pool: transfer a copy
+    const copy = new Uint8Array(data);
+    try {
+      return await this._request({ type: 'write', data: copy.buffer }, [copy.buffer]);
+    } catch (err) {
+      this._bleLogger.error('Write failed', { error: err.message });
+      return false;
+    }
+  }
+
+  /**
+   * @returns {Promise<number|null>} RSSI in dBm, or null if unavailable
+   */
+  async getRssi() {
+    try {
+      return await this._call('getRssi');
+    } catch {
+      return null;
+    }
+  }
+
+  /**
+   * Send a device module request and wait for its answer, see BleDevice.request().
+   * @param {string} name
+   * @param {Object} [options] - { timeout }
+   * @returns {Promise<Object>}
+   */
+  request(name, options = {}) {
+    return this._call('request', name, options);
+  }
+
+  /**
+   * @param {number} [timeout]
+   * @returns {Promise<number|null>} Battery percentage, or null if the device did not answer
+   */
+  async readBattery(timeout) {
+    try {
+      return await this._call('readBattery', timeout);
+    } catch {
+      return null;
+    }
+  }
+
+  /**
+   * Request the battery level; the result arrives as a 'battery' event.
+   */
+  requestBattery() {
+    this._call('requestBattery').catch(() => {});
+  }
+
+  /**
+   * @returns {number} Last battery level reported by the worker
+   */
+  getBatteryLevel() {
+    return this._batteryLevel;
+  }
+
+  /**
+   * Scan in the worker, see BleDevice.scan(). onDevice, signal and table
+   * work as they do unisolated.
+   * @param {number} [duration]
+   * @param {Object} [options] - { showAll, quiet, onDevice, signal, table }
+   * @returns {Promise<Array>}
+   */
+  async scan(duration, options = {}) {
+    const { onDevice = null, signal = null, table = null } = options;
+    if (signal?.aborted) return [];
+
+    let tableId = null;
+    if (table) {
+      tableId = this._tableIds.get(table);
+      if (!tableId) {
+        tableId = this._nextTableId++;
+        this._tableIds.set(table, tableId);
+      }
+    }
+
+    // Without a table of the caller's, entries only need turning into devices
+    const snapshots = table || new DeviceTable();
+    const onEntry = (record) => {
+      const entry = table ? table.importEntry(record) : record;
+      if (onDevice) onDevice(snapshots.snapshot(entry));
+    };
+    const id = this._nextId++;
+    const onAbort = () => this._worker?.postMessage({ type: 'scan:abort', id });
+    signal?.addEventListener('abort', onAbort);
+    try {
+      return await this._request({
+        type: 'scan',
+        duration,
+        options: {
+          showAll: !!options.showAll,
+          quiet: !!options.quiet,
+          stream: !!(onDevice || table),
+          table: tableId,
+        },
+      }, undefined, onEntry, id);
+    } finally {
+      signal?.removeEventListener('abort', onAbort);
+    }
+  }
+
+  /**
+   * noble lives in the worker and cannot be reached from here.
+   */
+  getNoble() {
+    throw new Error('noble runs in the BLE worker thread (ble.isolate) and is not accessible');
+  }
+
+  /**
+   * Disconnect and stop the worker.
+   */
+  async destroy() {
+    this._destroyed = true;
+    this._wantConnected = false;
+    try {
+      await this._call('destroy');
+    } catch {
+      // worker already gone
+    }
+    this._removeMetrics();
+    if (this._worker) await this._worker.terminate();
+  }
+}
+
+/**
+ * A BleDevice, or a BleDeviceProxy running it in a worker thread when
+ * config.isolate is set.
+ * @param {Object} config - BleDevice config, plus isolate
+ * @param {Object} logger
+ * @param {Object} deviceModule
+ * @returns {BleDevice|BleDeviceProxy}
+ */
+function createBleDevice(config, logger, deviceModule) {
+  return config.isolate ? new BleDeviceProxy(config, logger, deviceModule) : new BleDevice(config, logger, deviceModule);
+}
+
+module.exports = { BleDeviceProxy, createBleDevice };
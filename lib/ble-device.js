@@ -10,8 +10,28 @@
  */
 
 const { EventEmitter } = require('events');
-const { withBindings } = require('@stoprocent/noble');
+const { performance } = require('perf_hooks');
 const { scanForDevices } = require('./scanner');
+const { scanSchedulerFor } = require('./scan-scheduler');
+const { AdvertMatcher } = require('./advert-matcher');
+const { DiscoveryCache } = require('./discovery-cache');
+const { ReconnectScheduler } = require('./reconnect-scheduler');
+const { registry } = require('./metrics');
+
+const metrics = {
+  connectAttempts: registry.counter('ble_connect_attempts_total', 'BLE connection attempts'),
+  connectFailures: registry.counter('ble_connect_failures_total', 'Failed BLE connection attempts'),
+  connectDuration: registry.histogram('ble_connect_duration_seconds', 'Time to connect and set up characteristics'),
+  reconnects: registry.counter('ble_reconnects_total', 'Automatic reconnect attempts'),
+  disconnects: registry.counter('ble_disconnects_total', 'BLE disconnections, expected or not'),
+  connected: registry.gauge('ble_connected', 'Whether the BLE device is connected and ready (1) or not (0)'),
+  writeFailures: registry.counter('ble_write_failures_total', 'Failed BLE writes'),
+  requestDuration: registry.histogram('ble_request_duration_seconds', 'Time from a request write to the matching notification'),
+  requestTimeouts: registry.counter('ble_request_timeouts_total', 'Requests the device did not answer in time'),
+};
+const writeDuration = registry.histogram('ble_write_duration_seconds', 'BLE write latency', { labelNames: ['type'] });
+const writeWithResponse = writeDuration.labels('with_response');
+const writeWithoutResponse = writeDuration.labels('without_response');
 
 class BleDevice extends EventEmitter {
   /**
@@ -19,10 +39,21 @@ class BleDevice extends EventEmitter {
    * @param {string} [config.macAddress] - BLE MAC address (required on Linux, optional on macOS/Windows)
    * @param {string} [config.addressType='public'] - BLE address type
    * @param {number} [config.hciInterface=0] - HCI device index (Linux only)
-   * @param {number} [config.reconnectDelay=5000] - Delay before reconnect (ms)
+   * @param {number} [config.reconnectDelay=5000] - Maximum delay between reconnect attempts (ms)
+   * @param {number} [config.reconnectBaseDelay=250] - Backoff delay after the first immediate retry (ms)
    * @param {string[]} [config.deviceNamePatterns=[]] - Name patterns for scanning
    * @param {number} [config.scanDuration=10000] - Scan duration (ms)
+   * @param {number} [config.scanMaxDevices=1000] - Devices a scan keeps; the least recently seen are evicted
+   * @param {number} [config.scanDeviceTtl=60000] - Drop devices a scan has not seen for this long (ms)
    * @param {number} [config.batteryCheckInterval=1800000] - Battery check interval (ms)
+   * @param {string} [config.writeMode] - Override the device module's write mode
+   * @param {number} [config.writeBarrierEvery] - Override the device module's adaptive barrier spacing
+   * @param {string} [config.binding] - 'simulator' to use the simulated adapter instead of hardware
+   * @param {Object|string} [config.simulator] - Simulator scenario (object or path to a JSON file)
+   * @param {string} [config.discoveryCache] - File remembering the last connected peripheral; disabled when empty
+   * @param {number} [config.discoveryCacheTtl] - Ignore cached peripherals older than this (ms)
+   * @param {number} [config.cachedConnectTimeout=5000] - Give up a direct connect to a cached peripheral after this long (ms)
+   * @param {number} [config.requestTimeout=2000] - Default time to wait for the answer to a request (ms)
    * @param {Object} logger - Logger instance
    * @param {Object} deviceModule - Device module providing UUIDs, commands, and parsing
    */
@@ -34,9 +65,18 @@ class BleDevice extends EventEmitter {
       addressType: config.addressType || 'public',
       hciInterface: config.hciInterface || 0,
       reconnectDelay: config.reconnectDelay || 5000,
+      reconnectBaseDelay: config.reconnectBaseDelay || 250,
       deviceNamePatterns: config.deviceNamePatterns || [],
       scanDuration: config.scanDuration || 10000,
+      scanMaxDevices: config.scanMaxDevices || 1000,
+      scanDeviceTtl: config.scanDeviceTtl || 60000,
       batteryCheckInterval: config.batteryCheckInterval || 30 * 60 * 1000,
+      writeMode: config.writeMode || deviceModule.writeMode || 'without-response',
+      writeBarrierEvery: config.writeBarrierEvery || deviceModule.writeBarrierEvery || 8,
+      binding: config.binding || 'native',
+      simulator: config.simulator || {},
+      cachedConnectTimeout: config.cachedConnectTimeout || 5000,
+      requestTimeout: config.requestTimeout || 2000,
     };
 
     this._logger = logger;
@@ -51,18 +91,51 @@ class BleDevice extends EventEmitter {
     this._autoReconnect = true;
     this._batteryTimer = null;
     this._nobleInitialized = false;
+    this._gattCache = new Map(); // "<address>|<module>" -> { peripheral, tx, rx }
+    // Characteristics only outlive a connection where the bindings keep them
+    // valid. noble's HCI bindings (Linux, Windows) build a new GATT client
+    // per connection, so cached ones would fail their first use every time.
+    this._gattCacheEnabled = this._config.binding === 'simulator' || process.platform === 'darwin';
+    this._writesSinceBarrier = 0;
+    this._transactions = new Map(); // request name -> in-flight transaction, see request()
+    this._discoveryCache = config.discoveryCache
+      ? new DiscoveryCache({ path: config.discoveryCache, ttl: config.discoveryCacheTtl }, logger)
+      : null;
+    this._discoveryKey = `${this._config.binding}:${this._config.hciInterface}|${deviceModule.name}`;
+    this._matcher = new AdvertMatcher({
+      serviceUuids: [deviceModule._nobleUuids.service],
+      namePatterns: this._config.deviceNamePatterns,
+    });
+    metrics.connected.collect(() => (this.isConnected() ? 1 : 0));
+
+    this._reconnect = new ReconnectScheduler({
+      baseDelay: this._config.reconnectBaseDelay,
+      maxDelay: this._config.reconnectDelay,
+    }, () => {
+      metrics.reconnects.inc();
+      this.connect().catch((err) => {
+        this._bleLogger.error('Reconnection failed', { error: err.message });
+      });
+    });
   }
 
   /**
-   * Initialize noble with platform-appropriate bindings.
+   * Initialize noble with platform-appropriate bindings, or the simulated
+   * adapter when configured.
    */
   _initNoble() {
     if (this._nobleInitialized) return;
 
-    if (process.platform === 'darwin') {
+    if (this._config.binding === 'simulator') {
+      const { SimulatedNoble } = require('./sim-noble');
+      this._noble = new SimulatedNoble(this._config.simulator, this._deviceModule);
+      this._bleLogger.info('Noble initialized with simulated adapter');
+    } else if (process.platform === 'darwin') {
+      const { withBindings } = require('@stoprocent/noble');
       this._noble = withBindings('default');
       this._bleLogger.info('Noble initialized with macOS native bindings');
     } else {
+      const { withBindings } = require('@stoprocent/noble');
       this._noble = withBindings('hci', {
         hciDriver: 'native',
         deviceId: this._config.hciInterface,
@@ -70,9 +143,45 @@ class BleDevice extends EventEmitter {
       this._bleLogger.info(`Noble initialized with HCI bindings (device: hci${this._config.hciInterface})`);
     }
 
+    // Any scan that sees the device while a reconnect is pending triggers it
+    this._noble.on('discover', (peripheral) => this._onAdvert(peripheral));
+
     this._nobleInitialized = true;
   }
 
+  /**
+   * Connect directly to the peripheral in the discovery cache, skipping the
+   * scan. A miss, or a cached peripheral that cannot be reached within
+   * cachedConnectTimeout, returns null and the caller scans instead.
+   * @returns {Promise<Object|null>} Connected noble peripheral
+   */
+  async _connectCached() {
+    const entry = this._discoveryCache?.lookup(this._discoveryKey);
+    if (!entry) return null;
+
+    // Linux connects by address; CoreBluetooth knows peripherals by identifier
+    const target = entry.address || entry.id;
+    this._bleLogger.info('Connecting to cached device', { name: entry.name, target, addressType: entry.addressType });
+    let timer = null;
+    try {
+      return await Promise.race([
+        this._noble.connectAsync(target),
+        new Promise((resolve, reject) => {
+          timer = setTimeout(() => {
+            this._noble.cancelConnect?.(target);
+            reject(new Error(`no connection within ${this._config.cachedConnectTimeout}ms`));
+          }, this._config.cachedConnectTimeout);
+        }),
+      ]);
+    } catch (err) {
+      this._bleLogger.info('Cached device not reachable, scanning instead', { error: err.message });
+      this._discoveryCache.invalidate(this._discoveryKey);
+      return null;
+    } finally {
+      clearTimeout(timer);
+    }
+  }
+
   /**
    * Find a peripheral by name pattern or service UUID.
    * Used on macOS where CoreBluetooth doesn't expose MAC addresses.
@@ -80,37 +189,20 @@ class BleDevice extends EventEmitter {
    * @returns {Promise<Object>} Noble peripheral object
    */
   async _findPeripheral(timeout = 30000) {
-    const namePatterns = this._config.deviceNamePatterns;
-    const serviceUuid = this._deviceModule._nobleUuids.service;
-
     return new Promise((resolve, reject) => {
-      const timer = setTimeout(() => {
-        this._noble.stopScanningAsync().catch(() => {});
-        this._noble.removeListener('discover', onDiscover);
-        reject(new Error(`Device not found within ${timeout / 1000} seconds`));
-      }, timeout);
-
-      const onDiscover = (peripheral) => {
-        const name = peripheral.advertisement?.localName || '';
-        const serviceUuids = peripheral.advertisement?.serviceUuids || [];
-        const hasMatchingService = serviceUuids.includes(serviceUuid);
-        const matchesName = namePatterns.length > 0 &&
-          namePatterns.some(pattern => name.toLowerCase().includes(pattern.toLowerCase()));
-
-        if (hasMatchingService || matchesName) {
-          clearTimeout(timer);
-          this._noble.stopScanningAsync().catch(() => {});
-          this._noble.removeListener('discover', onDiscover);
+      // Joins any scan already running on the adapter instead of restarting it
+      const subscription = scanSchedulerFor(this._noble, this._logger).subscribe({
+        name: 'find device',
+        duration: timeout,
+        filter: peripheral => this._matchesDevice(peripheral),
+        onDiscover: (peripheral) => {
+          subscription.stop();
           resolve(peripheral);
-        }
-      };
-
-      this._noble.on('discover', onDiscover);
-      this._noble.startScanningAsync([], false).catch((err) => {
-        clearTimeout(timer);
-        this._noble.removeListener('discover', onDiscover);
-        reject(err);
+        },
       });
+      subscription.ready.catch(reject);
+      // No-op once resolved
+      subscription.done.then(() => reject(new Error(`Device not found within ${timeout / 1000} seconds`)));
     });
   }
 
@@ -125,70 +217,92 @@ class BleDevice extends EventEmitter {
     }
     this._isConnecting = true;
     this._autoReconnect = true;
+    this._reconnect.cancel();
+    metrics.connectAttempts.inc();
+    const startedAt = performance.now();
 
     this._initNoble();
 
     const { macAddress, addressType } = this._config;
-    const nobleUuids = this._deviceModule._nobleUuids;
     this._bleLogger.info('Connecting to device', { address: macAddress || '(scan)', addressType });
 
     try {
       await this._noble.waitForPoweredOnAsync();
 
-      if (process.platform === 'linux' && macAddress) {
+      const byAddress = process.platform === 'linux' || this._config.binding === 'simulator';
+      if (byAddress && macAddress) {
         // Linux: connect directly by MAC address via HCI
         this._peripheral = await this._noble.connectAsync(macAddress);
-      } else if (process.platform === 'linux' && !macAddress) {
-        throw new Error('MAC address is required on Linux. Use the BLE scanner to find your device, or set device.macAddress in config.');
       } else {
-        // macOS/Windows: scan to find device by service UUID or name pattern
-        this._bleLogger.info('Scanning to find device...');
-        this._peripheral = await this._findPeripheral();
-        this._bleLogger.info(`Found device: ${this._peripheral.advertisement?.localName || this._peripheral.address}`);
-        await this._peripheral.connectAsync();
+        // The peripheral from last time, if cached; otherwise (or if it is
+        // not reachable) scan to find it by service UUID or name pattern
+        this._peripheral = await this._connectCached();
+        if (!this._peripheral) {
+          if (process.platform === 'linux' && !this._discoveryCache && this._config.binding !== 'simulator') {
+            throw new Error('MAC address is required on Linux. Use the BLE scanner to find your device, set device.macAddress in config, or enable ble.discoveryCache.');
+          }
+          this._bleLogger.info('Scanning to find device...');
+          this._peripheral = await this._findPeripheral();
+          this._bleLogger.info(`Found device: ${this._peripheral.advertisement?.localName || this._peripheral.address}`);
+          await this._peripheral.connectAsync();
+        }
       }
+      this._discoveryCache?.record(this._discoveryKey, {
+        id: this._peripheral.id,
+        address: this._peripheral.address,
+        addressType: this._peripheral.addressType,
+        name: this._peripheral.advertisement?.localName,
+        rssi: this._peripheral.rssi,
+      });
 
       this._bleLogger.info(`Connected to ${this._peripheral.advertisement?.localName || this._peripheral.address}`);
 
-      // Discover service and characteristics using device module UUIDs
-      const { characteristics } = await this._peripheral.discoverSomeServicesAndCharacteristicsAsync(
-        [nobleUuids.service],
-        [nobleUuids.tx, nobleUuids.rx]
-      );
-
-      for (const char of characteristics) {
-        // RX characteristic - subscribe for notifications
-        if (char.uuid === nobleUuids.rx) {
-          await char.subscribeAsync();
-          char.removeAllListeners('data');
-          char.on('data', (data, isNotification) => {
-            if (!isNotification) return;
-            if (typeof this._deviceModule.parseNotification === 'function') {
-              const result = this._deviceModule.parseNotification(data);
-              if (result && result.type === 'battery') {
-                this._batteryLevel = result.level;
-                this._bleLogger.info(`Battery level: ${this._batteryLevel}%`);
-                this.emit('battery', this._batteryLevel);
-              } else if (result) {
-                this.emit('notification', result);
-              }
-            }
-          });
+      let { tx, rx, cached } = await this._getCharacteristics(this._peripheral);
+
+      // RX characteristic - subscribe for notifications. This is also the
+      // first GATT operation, so it validates cached handles.
+      if (rx) {
+        try {
+          await rx.subscribeAsync();
+        } catch (err) {
+          if (!cached) throw err;
+          this._bleLogger.debug('Cached GATT handles rejected, rediscovering', { error: err.message });
+          this._gattCache.delete(this._gattCacheKey(this._peripheral));
+          ({ tx, rx } = await this._getCharacteristics(this._peripheral));
+          if (rx) await rx.subscribeAsync();
         }
+      }
 
-        // TX characteristic - save for sending commands
-        if (char.uuid === nobleUuids.tx) {
-          this._txChar = char;
-          this._bleLogger.info('Device ready for commands');
-          this.requestBattery();
-        }
+      if (rx) {
+        rx.removeAllListeners('data');
+        rx.on('data', (data, isNotification) => {
+          if (!isNotification) return;
+          if (typeof this._deviceModule.parseNotification === 'function') {
+            const result = this._deviceModule.parseNotification(data);
+            if (result && result.type === 'battery') {
+              this._batteryLevel = result.level;
+              this._bleLogger.info(`Battery level: ${this._batteryLevel}%`);
+              this.emit('battery', this._batteryLevel);
+            } else if (result) {
+              this.emit('notification', result);
+            }
+            if (result && this._transactions.size > 0) this._settleTransactions(result);
+          }
+        });
       }
 
-      if (!this._txChar) {
+      // TX characteristic - save for sending commands
+      if (tx) {
+        this._txChar = tx;
+        this._bleLogger.info('Device ready for commands');
+        this.requestBattery();
+      } else {
         this._bleLogger.error('TX characteristic not found on device');
       }
 
       this._isConnecting = false;
+      this._reconnect.reset();
+      metrics.connectDuration.observe((performance.now() - startedAt) / 1000);
 
       // Start battery check interval
       if (this._batteryTimer) clearInterval(this._batteryTimer);
@@ -199,45 +313,109 @@ class BleDevice extends EventEmitter {
       // Handle disconnect
       this._peripheral.once('disconnect', () => {
         this._bleLogger.warn('Disconnected from device');
+        metrics.disconnects.inc();
         this._txChar = null;
         this._peripheral = null;
         if (this._batteryTimer) {
           clearInterval(this._batteryTimer);
           this._batteryTimer = null;
         }
+        this._failTransactions(new Error('Device disconnected'));
 
         this.emit('disconnected');
 
         if (this._autoReconnect) {
-          const delay = this._config.reconnectDelay;
-          this._bleLogger.info(`Reconnecting in ${delay / 1000} seconds...`);
-          setTimeout(() => {
-            this.connect().catch((err) => {
-              this._bleLogger.error('Reconnection failed', { error: err.message });
-            });
-          }, delay);
+          const delay = this._reconnect.schedule();
+          this._bleLogger.info(delay ? `Reconnecting in ${delay}ms...` : 'Reconnecting...');
         }
       });
 
     } catch (err) {
       this._isConnecting = false;
+      metrics.connectFailures.inc();
       this._bleLogger.error('Connection failed', { error: err.message });
 
       if (this._autoReconnect) {
-        const delay = this._config.reconnectDelay;
-        this._bleLogger.info(`Retrying connection in ${delay / 1000} seconds...`);
-        setTimeout(() => {
-          this.connect().catch(() => {});
-        }, delay);
+        const delay = this._reconnect.schedule();
+        this._bleLogger.info(delay ? `Retrying connection in ${delay}ms (sooner if the device advertises)...` : 'Retrying connection...');
       }
     }
   }
 
+  /**
+   * Cache key for GATT characteristics: one entry per peripheral and device module.
+   * @param {Object} peripheral - Noble peripheral
+   * @returns {string}
+   */
+  _gattCacheKey(peripheral) {
+    return `${peripheral.address || peripheral.id}|${this._deviceModule.name}`;
+  }
+
+  /**
+   * Resolve the TX/RX characteristics of a connected peripheral.
+   * Reuses characteristics discovered on an earlier connection to the same
+   * peripheral object, so reconnects skip service discovery (macOS and the
+   * simulator only, see _gattCacheEnabled).
+   * @param {Object} peripheral - Connected noble peripheral
+   * @returns {Promise<{ tx: Object|null, rx: Object|null, cached: boolean }>}
+   */
+  async _getCharacteristics(peripheral) {
+    const key = this._gattCacheKey(peripheral);
+    const entry = this._gattCacheEnabled ? this._gattCache.get(key) : undefined;
+    if (entry && entry.peripheral === peripheral) {
+      this._bleLogger.debug('Using cached GATT characteristics', { key });
+      return { tx: entry.tx, rx: entry.rx, cached: true };
+    }
+
+    // Discover service and characteristics using device module UUIDs
+    const nobleUuids = this._deviceModule._nobleUuids;
+    const { characteristics } = await peripheral.discoverSomeServicesAndCharacteristicsAsync(
+      [nobleUuids.service],
+      [nobleUuids.tx, nobleUuids.rx]
+    );
+
+    const tx = characteristics.find(char => char.uuid === nobleUuids.tx) || null;
+    const rx = characteristics.find(char => char.uuid === nobleUuids.rx) || null;
+    if (tx && this._gattCacheEnabled) {
+      this._gattCache.set(key, { peripheral, tx, rx });
+    }
+    return { tx, rx, cached: false };
+  }
+
+  /**
+   * Pull a pending reconnect forward when the target device advertises.
+   * @param {Object} peripheral - Noble peripheral from a 'discover' event
+   */
+  _onAdvert(peripheral) {
+    if (!this._reconnect.pending || this._isConnecting) return;
+
+    const { macAddress } = this._config;
+    const isTarget = macAddress
+      ? peripheral.address?.toLowerCase() === macAddress.toLowerCase()
+      : this._matchesDevice(peripheral);
+
+    if (isTarget) {
+      this._bleLogger.info('Device advertising again, reconnecting now');
+      this._reconnect.expedite();
+    }
+  }
+
+  /**
+   * Check whether a peripheral's advert matches the device module's service
+   * UUID or a configured name pattern.
+   * @param {Object} peripheral - Noble peripheral
+   * @returns {boolean}
+   */
+  _matchesDevice(peripheral) {
+    return this._matcher.matches(peripheral);
+  }
+
   /**
    * Disconnect from the BLE device. Does NOT auto-reconnect.
    */
   async disconnect() {
     this._autoReconnect = false;
+    this._reconnect.cancel();
 
     if (this._batteryTimer) {
       clearInterval(this._batteryTimer);
@@ -255,6 +433,7 @@ class BleDevice extends EventEmitter {
     this._txChar = null;
     this._peripheral = null;
     this._isConnecting = false;
+    this._failTransactions(new Error('Device disconnected'));
   }
 
   /**
@@ -267,6 +446,13 @@ class BleDevice extends EventEmitter {
 
   /**
    * Write data to the BLE TX characteristic.
+   *
+   * The write type follows the write mode policy:
+   * - 'without-response': fastest, but no flow control or delivery signal
+   * - 'with-response': every write waits for the device's ATT response
+   * - 'adaptive': without response, except every writeBarrierEvery-th write
+   *   (and the write after a failure) goes with response, so the queue
+   *   drains at least that often and losses surface as errors
    * @param {Buffer} data - Data to write
    * @returns {Promise<boolean>} True if write succeeded
    */
@@ -276,15 +462,44 @@ class BleDevice extends EventEmitter {
       return false;
     }
 
+    const withoutResponse = this._nextWriteWithoutResponse();
+    const startedAt = performance.now();
     try {
-      await this._txChar.writeAsync(data, true); // true = without response
+      await this._txChar.writeAsync(data, withoutResponse);
+      (withoutResponse ? writeWithoutResponse : writeWithResponse).observe((performance.now() - startedAt) / 1000);
       return true;
     } catch (err) {
-      this._bleLogger.error('Write failed', { error: err.message });
+      metrics.writeFailures.inc();
+      this._writesSinceBarrier = this._config.writeBarrierEvery; // next write is a barrier
+      this._bleLogger.error('Write failed', { error: err.message, withoutResponse });
       return false;
     }
   }
 
+  /**
+   * Decide the write type for the next write under the write mode policy.
+   * @returns {boolean} True for write-without-response
+   */
+  _nextWriteWithoutResponse() {
+    const properties = this._txChar.properties || [];
+    const canWithout = properties.length === 0 || properties.includes('writeWithoutResponse');
+    const canWith = properties.length === 0 || properties.includes('write');
+
+    switch (this._config.writeMode) {
+      case 'with-response':
+        return !canWith;
+      case 'adaptive':
+        if (!canWith) return true;
+        if (!canWithout || ++this._writesSinceBarrier >= this._config.writeBarrierEvery) {
+          this._writesSinceBarrier = 0;
+          return false;
+        }
+        return true;
+      default:
+        return canWithout;
+    }
+  }
+
   /**
    * Read the current RSSI value from the connected peripheral.
    * @returns {Promise<number|null>} RSSI in dBm, or null if unavailable
@@ -299,18 +514,99 @@ class BleDevice extends EventEmitter {
     }
   }
 
+  /**
+   * Send one of the device module's requests and wait for the notification
+   * that answers it (the first parseNotification() result its match()
+   * accepts). Concurrent calls for the same request share one write and
+   * one answer; each caller still waits no longer than its own timeout.
+   * @param {string} name - Key in the device module's `requests`
+   * @param {Object} [options]
+   * @param {number} [options.timeout] - Max wait for the answer (ms), default config.requestTimeout
+   * @returns {Promise<Object>} The matching parseNotification() result
+   * @throws {Error} Unknown request, not connected, write failed, timed out or disconnected
+   */
+  request(name, options = {}) {
+    const spec = this._deviceModule.requests?.[name];
+    if (!spec) return Promise.reject(new Error(`Device module has no "${name}" request`));
+    if (!this._txChar) return Promise.reject(new Error('Device not connected'));
+    const timeout = options.timeout || this._config.requestTimeout;
+
+    let transaction = this._transactions.get(name);
+    if (!transaction) {
+      transaction = { name, match: spec.match, waiters: new Set(), startedAt: performance.now() };
+      this._transactions.set(name, transaction);
+      this.write(spec.build()).then((ok) => {
+        if (!ok) this._endTransaction(transaction, new Error(`Write of "${name}" request failed`));
+      });
+    }
+
+    return new Promise((resolve, reject) => {
+      const waiter = { resolve, reject, timer: null };
+      waiter.timer = setTimeout(() => {
+        transaction.waiters.delete(waiter);
+        metrics.requestTimeouts.inc();
+        // The last waiter gone: a later call writes the request again
+        if (transaction.waiters.size === 0 && this._transactions.get(name) === transaction) {
+          this._transactions.delete(name);
+        }
+        reject(new Error(`No answer to "${name}" request within ${timeout}ms`));
+      }, timeout);
+      transaction.waiters.add(waiter);
+    });
+  }
+
+  _settleTransactions(result) {
+    for (const transaction of Array.from(this._transactions.values())) {
+      let matched = false;
+      try {
+        matched = transaction.match(result);
+      } catch (err) {
+        this._bleLogger.error('Request matcher failed', { request: transaction.name, error: err.message });
+      }
+      if (matched) {
+        metrics.requestDuration.observe((performance.now() - transaction.startedAt) / 1000);
+        this._endTransaction(transaction, null, result);
+      }
+    }
+  }
+
+  _failTransactions(error) {
+    for (const transaction of Array.from(this._transactions.values())) this._endTransaction(transaction, error);
+  }
+
+  _endTransaction(transaction, error, result) {
+    if (this._transactions.get(transaction.name) === transaction) this._transactions.delete(transaction.name);
+    for (const waiter of transaction.waiters) {
+      clearTimeout(waiter.timer);
+      if (error) waiter.reject(error);
+      else waiter.resolve(result);
+    }
+    transaction.waiters.clear();
+  }
+
+  /**
+   * Ask the device for its battery level and wait for the answer.
+   * @param {number} [timeout] - Max wait (ms), default config.requestTimeout
+   * @returns {Promise<number|null>} Battery percentage, or null if the device did not answer
+   */
+  async readBattery(timeout) {
+    try {
+      const result = await this.request('battery', { timeout });
+      return result.level;
+    } catch (err) {
+      this._bleLogger.debug('Battery request failed', { error: err.message });
+      return null;
+    }
+  }
+
   /**
    * Request battery level from the device (fire-and-forget).
    * Result arrives asynchronously via the 'battery' event.
-   * Only works if the device module provides buildBatteryRequest().
+   * Only works if the device module has a battery request.
    */
   requestBattery() {
-    if (!this._txChar) return;
-    if (typeof this._deviceModule.buildBatteryRequest !== 'function') return;
-    const command = this._deviceModule.buildBatteryRequest();
-    if (command) {
-      this.write(command);
-    }
+    if (!this._txChar || !this._deviceModule.requests?.battery) return;
+    this.readBattery();
   }
 
   /**
@@ -326,7 +622,7 @@ class BleDevice extends EventEmitter {
    * @param {number} [duration] - Scan duration in ms (defaults to config value)
    * @param {Object} [options] - Scan options
    * @param {boolean} [options.showAll=false] - Return all devices, not just compatible ones
-   * @returns {Promise<Array<{ address: string, name: string, rssi: number }>>}
+   * @returns {Promise<Array<{ address: string, name: string, rssi: number, rssiStats: Object }>>}
    */
   async scan(duration, options) {
     this._initNoble();
@@ -337,7 +633,12 @@ class BleDevice extends EventEmitter {
       scanDuration,
       this._config.deviceNamePatterns,
       this._deviceModule._nobleUuids.service,
-      options
+      {
+        maxDevices: this._config.scanMaxDevices,
+        deviceTtl: this._config.scanDeviceTtl,
+        ...options,
+        matcher: this._matcher,
+      }
     );
   }
 
@@ -355,6 +656,7 @@ class BleDevice extends EventEmitter {
    */
   async destroy() {
     await this.disconnect();
+    await this._discoveryCache?.close();
     if (this._noble) {
       this._noble.stop();
     }
@@ -0,0 +1,114 @@
+/**
+ * Worker thread entry for ble.isolate: runs BleDevice, the scanner and
+ * noble's HCI stack off the main event loop.
+ *
+ * Driven by BleDeviceProxy (lib/ble-device-proxy.js) over postMessage.
+ * Parent -> worker:
+ *   { type: 'call', id, method, args }      connect, disconnect, getRssi, request, readBattery, requestBattery, destroy
+ *   { type: 'write', id, data }             data is a transferred ArrayBuffer
+ *   { type: 'scan', id, duration, options } options: { showAll, quiet, stream, table }
+ *   { type: 'scan:abort', id }
+ * Worker -> parent:
+ *   { type: 'result', id, value | error }
+ *   { type: 'event', name, args }           BleDevice events
+ *   { type: 'state', connected, batteryLevel }  after anything that may change them
+ *   { type: 'scan:device', id, entry }      DeviceTable.exportEntry() of a new or changed device
+ *   { type: 'log', records }                see Logger.remote()
+ *   { type: 'metrics', text }               this thread's registry, every METRICS_INTERVAL
+ *
+ * A scan with options.table keeps its devices in a table that lives here
+ * under that id and is reused by later scans with the same id, so a scan
+ * session's RSSI statistics span its radio scans as they do unisolated.
+ */
+
+const { parentPort, workerData } = require('worker_threads');
+const { BleDevice } = require('./ble-device');
+const { DeviceTable } = require('./device-table');
+const { loadDeviceModule } = require('./device-loader');
+const { Logger } = require('./logger');
+const { registry } = require('./metrics');
+
+const METRICS_INTERVAL = 5000;
+// Shared scan tables kept for reuse; sessions run one at a time
+const MAX_TABLES = 4;
+
+// Record data is JSON text already, so records always clone
+const logger = Logger.remote(workerData.logger, records => parentPort.postMessage({ type: 'log', records }));
+const bleDevice = new BleDevice(workerData.config, logger, loadDeviceModule(workerData.moduleName));
+
+const tables = new Map(); // table id -> DeviceTable
+const scans = new Map(); // scan id -> AbortController
+let lastState = null;
+
+function postState() {
+  const connected = bleDevice.isConnected();
+  const batteryLevel = bleDevice.getBatteryLevel();
+  if (lastState && lastState.connected === connected && lastState.batteryLevel === batteryLevel) return;
+  lastState = { connected, batteryLevel };
+  parentPort.postMessage({ type: 'state', connected, batteryLevel });
+}
+
+for (const name of ['connected', 'disconnected', 'battery', 'notification']) {
+  bleDevice.on(name, (...args) => {
+    postState();
+    parentPort.postMessage({ type: 'event', name, args });
+  });
+}
+
+function sharedTable(id) {
+  let table = tables.get(id);
+  if (table) {
+    tables.delete(id); // most recently used last
+  } else {
+    if (tables.size >= MAX_TABLES) tables.delete(tables.keys().next().value);
+    table = new DeviceTable({ capacity: workerData.config.scanMaxDevices, ttl: workerData.config.scanDeviceTtl });
+  }
+  tables.set(id, table);
+  return table;
+}
+
+function scan(id, duration, options) {
+  const abort = new AbortController();
+  scans.set(id, abort);
+  const table = options.table ? sharedTable(options.table) : new DeviceTable({
+    capacity: workerData.config.scanMaxDevices,
+    ttl: workerData.config.scanDeviceTtl,
+  });
+  return bleDevice.scan(duration, {
+    showAll: options.showAll,
+    quiet: options.quiet,
+    signal: abort.signal,
+    table,
+    onDevice: options.stream ? (device) => {
+      const entry = table.get(device.address);
+      if (entry) parentPort.postMessage({ type: 'scan:device', id, entry: table.exportEntry(entry) });
+    } : null,
+  }).finally(() => scans.delete(id));
+}
+
+async function handle(msg) {
+  switch (msg.type) {
+    case 'call':
+      return bleDevice[msg.method](...(msg.args || []));
+    case 'write':
+      return bleDevice.write(Buffer.from(msg.data));
+    case 'scan':
+      return scan(msg.id, msg.duration, msg.options);
+    default:
+      throw new Error(`Unknown message type: ${msg.type}`);
+  }
+}
+
+parentPort.on('message', (msg) => {
+  if (msg.type === 'scan:abort') {
+    scans.get(msg.id)?.abort();
+    return;
+  }
+  handle(msg).then(
+    value => parentPort.postMessage({ type: 'result', id: msg.id, value }),
+    error => parentPort.postMessage({ type: 'result', id: msg.id, error: error.message })
+  ).finally(postState);
+});
+
+setInterval(() => parentPort.postMessage({ type: 'metrics', text: registry.render() }), METRICS_INTERVAL).unref();
+postState();
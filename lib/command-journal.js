@@ -0,0 +1,880 @@
+/**
+ * Append-only binary journal of sent commands.
+ *
+ * Every command is recorded once its first write completes, with its
+ * originator, control values, route (local BLE or forwarder node), latency
+ * and result. append() only encodes the record into an in-memory batch;
+ * batches are written to the active segment file off the calling path.
+ *
+ * The journal is a directory of numbered segments:
+ *
+ *   00000001.log   header ['CJLG'][u16 version][u16 0][u32 coversFrom][u32 0]
+ *                  records [u16 length][u32 crc32][body]
+ *   00000001.idx   header ['CJIX'][u16 version][u16 0][u32 coversFrom][u32 0]
+ *                  entries [f64 time][u32 offset], fixed width
+ *
+ * Record body:
+ *
+ *   [f64 time ms][u8 flags][varint latency us][u8 len][originator]
+ *   ([u8 len][node id] for node routes)
+ *   [u8 count] count x ([u8 len][control id][varint zigzag value])
+ *
+ *   flags: bit 0 success, bits 1-2 route (0 none, 1 local, 2 node),
+ *          bit 3 superseded, bit 4 dropped (not sent; success is 0)
+ *
+ * Times are forced to be non-decreasing, so segments and index entries are
+ * in time order. The index is sparse (one entry per indexInterval bytes) and
+ * fixed width: a range read binary-searches it and scans at most
+ * indexInterval bytes before the first match. A segment is sealed when it
+ * reaches segmentSize or segmentMaxAge, and on restart.
+ *
+ * Compaction deletes sealed segments past maxAge or beyond maxBytes, and
+ * merges runs of small adjacent segments into the later one. A segment's
+ * coversFrom is the first segment number it contains, so a leftover from an
+ * interrupted merge is recognised and deleted on the next start. The index
+ * is derived data: it is rebuilt when missing or when its coversFrom does
+ * not match the log.
+ *
+ * Records still in the in-memory batch (up to flushInterval) are lost on a
+ * crash; a torn record at the end of a segment is truncated on the next start.
+ */
+
+const fs = require('fs');
+const path = require('path');
+const { writeFileAtomic, writeFileAtomicSync } = require('./atomic-write');
+const { writeVarint, readVarint } = require('./node-protocol');
+const { registry } = require('./metrics');
+const { WriteResult } = require('./constants');
+
+const LOG_MAGIC = 0x474c4a43; // 'CJLG' little-endian
+const IDX_MAGIC = 0x58494a43; // 'CJIX' little-endian
+const VERSION = 1;
+const FILE_HEADER = 16;
+const RECORD_HEADER = 6; // u16 length + u32 crc
+const INDEX_ENTRY = 12;
+const MIN_BODY = 12; // time, flags, latency, empty originator, control count
+
+const FLAG_SUCCESS = 1;
+const FLAG_SUPERSEDED = 8;
+const FLAG_DROPPED = 16;
+const ROUTE_NONE = 0;
+const ROUTE_LOCAL = 1;
+const ROUTE_NODE = 2;
+const ROUTE_NAMES = ['none', 'local', 'node'];
+
+// Strings are capped at 255 bytes and controls at 12, which bounds a record
+const MAX_CONTROLS = 12;
+const STRING_CACHE_SIZE = 64;
+const MAX_RECORD = RECORD_HEADER + 8 + 1 + 10 + 2 * 256 + 1 + MAX_CONTROLS * (256 + 10);
+const BATCH_SIZE = 64 * 1024;
+const READ_CHUNK = 64 * 1024;
+
+const SEGMENT_FILE = /^(\d{8})\.log$/;
+
+const metrics = {
+  records: registry.counter('journal_records_total', 'Commands recorded in the journal'),
+  writeFailures: registry.counter('journal_write_failures_total', 'Failed journal batch writes'),
+  bytes: registry.gauge('journal_bytes', 'Size of all journal segments'),
+  segments: registry.gauge('journal_segments', 'Number of journal segments'),
+};
+
+const CRC_TABLE = new Int32Array(256);
+for (let n = 0; n < 256; n++) {
+  let c = n;
+  for (let k = 0; k < 8; k++) c = c & 1 ? 0xedb88320 ^ (c >>> 1) : c >>> 1;
+  CRC_TABLE[n] = c;
+}
+
+function crc32(buf, start, end) {
+  let crc = -1;
+  for (let i = start; i < end; i++) crc = CRC_TABLE[(crc ^ buf[i]) & 0xff] ^ (crc >>> 8);
+  return (crc ^ -1) >>> 0;
+}
+
+/**
+ * Encode a string as [u8 length][utf8], truncated to 255 bytes.
+ * @param {string} value
+ * @returns {Buffer}
+ */
+function encodeString(value) {
+  const bytes = Buffer.from(String(value), 'utf8');
+  let length = Math.min(bytes.length, 255);
+  // Do not cut a multi-byte character in half
+  while (length < bytes.length && (bytes[length] & 0xc0) === 0x80) length--;
+  const buf = Buffer.allocUnsafe(1 + length);
+  buf[0] = length;
+  bytes.copy(buf, 1, 0, length);
+  return buf;
+}
+
+function writeBytes(buf, offset, bytes) {
+  for (let i = 0; i < bytes.length; i++) buf[offset + i] = bytes[i];
+  return offset + bytes.length;
+}
+
+function readString(buf, offset, end) {
+  const length = buf[offset];
+  if (offset + 1 + length > end) return null;
+  return { value: buf.toString('utf8', offset + 1, offset + 1 + length), offset: offset + 1 + length };
+}
+
+/**
+ * Control values are integers (range levels, 0/1 for actions).
+ * @param {*} value
+ * @returns {number}
+ */
+function toInteger(value) {
+  if (typeof value === 'number') return Number.isFinite(value) ? Math.round(value) : 0;
+  if (value === true || value === 'true') return 1;
+  const number = Number(value);
+  return Number.isFinite(number) ? Math.round(number) : 0;
+}
+
+function fileHeader(magic, coversFrom) {
+  const buf = Buffer.alloc(FILE_HEADER);
+  buf.writeUInt32LE(magic, 0);
+  buf.writeUInt16LE(VERSION, 4);
+  buf.writeUInt32LE(coversFrom, 8);
+  return buf;
+}
+
+/**
+ * @returns {number|null} coversFrom, or null if the header is not valid
+ */
+function parseFileHeader(buf, magic) {
+  if (buf.length < FILE_HEADER || buf.readUInt32LE(0) !== magic || buf.readUInt16LE(4) !== VERSION) return null;
+  return buf.readUInt32LE(8);
+}
+
+function encodeIndex(segment) {
+  const buf = Buffer.allocUnsafe(FILE_HEADER + segment.times.length * INDEX_ENTRY);
+  fileHeader(IDX_MAGIC, segment.coversFrom).copy(buf, 0);
+  for (let i = 0; i < segment.times.length; i++) {
+    buf.writeDoubleLE(segment.times[i], FILE_HEADER + i * INDEX_ENTRY);
+    buf.writeUInt32LE(segment.offsets[i], FILE_HEADER + i * INDEX_ENTRY + 8);
+  }
+  return buf;
+}
+
+/**
+ * Decode one record.
+ * @param {Buffer} buf
+ * @param {number} start - Offset of the record header
+ * @returns {Object|null} Null when the record is torn or corrupt
+ */
+function decodeRecord(buf, start) {
+  const length = buf.readUInt16LE(start);
+  const bodyStart = start + RECORD_HEADER;
+  const end = bodyStart + length;
+  if (end > buf.length || length < MIN_BODY) return null;
+  if (crc32(buf, bodyStart, end) !== buf.readUInt32LE(start + 2)) return null;
+
+  const time = buf.readDoubleLE(bodyStart);
+  const flags = buf[bodyStart + 8];
+  const latency = readVarint(buf, bodyStart + 9);
+  if (!latency) return null;
+  const originator = readString(buf, latency.offset, end);
+  if (!originator) return null;
+  let offset = originator.offset;
+
+  const routeKind = (flags >> 1) & 3;
+  let route = ROUTE_NAMES[routeKind];
+  if (routeKind === ROUTE_NODE) {
+    const nodeId = readString(buf, offset, end);
+    if (!nodeId) return null;
+    route = nodeId.value;
+    offset = nodeId.offset;
+  }
+
+  const controls = {};
+  const count = buf[offset++];
+  for (let i = 0; i < count; i++) {
+    const id = readString(buf, offset, end);
+    if (!id) return null;
+    const value = readVarint(buf, id.offset);
+    if (!value) return null;
+    controls[id.value] = value.value % 2 === 0 ? value.value / 2 : -(value.value + 1) / 2;
+    offset = value.offset;
+  }
+
+  return {
+    time,
+    originator: originator.value,
+    route,
+    controls,
+    latencyMs: latency.value / 1000,
+    success: (flags & FLAG_SUCCESS) !== 0,
+    result: resultOf(flags),
+  };
+}
+
+function resultOf(flags) {
+  if (flags & FLAG_SUCCESS) return WriteResult.WRITTEN;
+  if (flags & FLAG_SUPERSEDED) return WriteResult.SUPERSEDED;
+  if (flags & FLAG_DROPPED) return WriteResult.DROPPED;
+  return WriteResult.FAILED;
+}
+
+function resultFlags(result) {
+  switch (result) {
+    case WriteResult.WRITTEN: return FLAG_SUCCESS;
+    case WriteResult.SUPERSEDED: return FLAG_SUPERSEDED;
+    case WriteResult.DROPPED: return FLAG_DROPPED;
+    default: return 0;
+  }
+}
+
+/**
+ * Walk the records of a log buffer, stopping at the first torn or corrupt one.
+ * @param {Buffer} buf - Log content
+ * @param {number} start - Offset of the first record
+ * @param {Function} onRecord - (offset, time) => void
+ * @returns {number} Offset after the last valid record
+ */
+function scanRecords(buf, start, onRecord) {
+  let offset = start;
+  while (offset + RECORD_HEADER <= buf.length) {
+    const length = buf.readUInt16LE(offset);
+    const end = offset + RECORD_HEADER + length;
+    if (length < MIN_BODY || end > buf.length) break;
+    if (crc32(buf, offset + RECORD_HEADER, end) !== buf.readUInt32LE(offset + 2)) break;
+    onRecord(offset, buf.readDoubleLE(offset + RECORD_HEADER));
+    offset = end;
+  }
+  return offset;
+}
+
+class CommandJournal {
+  /**
+   * @param {Object} config
+   * @param {string} config.dir - Directory holding the segments
+   * @param {string[]} [config.controlIds] - Control ids recorded from each command
+   * @param {number} [config.segmentSize=1048576] - Seal a segment at this size (bytes)
+   * @param {number} [config.segmentMaxAge=86400000] - Seal a segment after this long (ms)
+   * @param {number} [config.indexInterval=4096] - Bytes between index entries
+   * @param {number} [config.flushInterval=1000] - Max delay before records are written (ms)
+   * @param {number} [config.maxAge=2592000000] - Delete segments older than this (ms)
+   * @param {number} [config.maxBytes=67108864] - Delete the oldest segments beyond this total size
+   * @param {number} [config.compactInterval=3600000] - Time between compaction runs (ms)
+   * @param {Object} logger - Logger instance
+   */
+  constructor(config, logger) {
+    this._config = {
+      dir: config.dir,
+      controlIds: (config.controlIds || []).slice(0, MAX_CONTROLS),
+      segmentSize: config.segmentSize || 1048576,
+      segmentMaxAge: config.segmentMaxAge || 86400000,
+      indexInterval: config.indexInterval || 4096,
+      flushInterval: config.flushInterval ?? 1000,
+      maxAge: config.maxAge || 30 * 86400000,
+      maxBytes: config.maxBytes || 64 * 1048576,
+      compactInterval: config.compactInterval || 3600000,
+    };
+    this._logger = logger.child('journal');
+
+    // Control ids are encoded once; originators and node ids repeat, so
+    // their encodings are cached
+    this._controlIdBytes = this._config.controlIds.map(encodeString);
+    this._strings = new Map();
+
+    this._segments = []; // oldest first; the last one may be active
+    this._active = null;
+    this._lastSeq = 0;
+    this._lastTime = 0;
+    this._closed = false;
+
+    this._batch = Buffer.allocUnsafe(BATCH_SIZE);
+    this._batchLength = 0;
+    this._flushTimer = null;
+    this._queue = []; // { segment, data, indexEnd, seal }
+    this._writing = null;
+
+    this._readers = 0;
+    this._compaction = null;
+
+    this._load();
+
+    metrics.bytes.collect(() => this._segments.reduce((total, segment) => total + segment.size, 0));
+    metrics.segments.collect(() => this._segments.length);
+
+    this._compactTimer = setInterval(() => this.compact(), this._config.compactInterval);
+    this._compactTimer.unref?.();
+    setImmediate(() => this.compact());
+  }
+
+  /**
+   * Record a completed command. Only encodes into the in-memory batch.
+   * @param {string} originator - Client address or source name
+   * @param {Object} commands - Control values; only configured control ids are recorded
+   * @param {string|null} route - 'local', a forwarder node id, or null when nothing could send
+   * @param {number} latencyMs - Receipt to completion
+   * @param {string} result - WriteResult
+   */
+  append(originator, commands, route, latencyMs, result) {
+    if (this._closed) return;
+    if (this._batch.length - this._batchLength < MAX_RECORD + FILE_HEADER) this._queueBatch(false);
+
+    let time = Date.now();
+    if (time < this._lastTime) time = this._lastTime;
+    this._lastTime = time;
+
+    let segment = this._active;
+    if (!segment || segment.failed || segment.size >= this._config.segmentSize
+      || time - segment.firstTime >= this._config.segmentMaxAge) {
+      segment = this._roll(time);
+    }
+
+    const buf = this._batch;
+    const start = this._batchLength;
+    let offset = start + RECORD_HEADER;
+    buf.writeDoubleLE(time, offset);
+    const flagsAt = offset + 8;
+    offset = writeVarint(buf, flagsAt + 1, Math.max(0, Math.round(latencyMs * 1000)));
+    offset = writeBytes(buf, offset, this._encoded(originator));
+
+    let routeKind = ROUTE_NONE;
+    if (route === 'local') {
+      routeKind = ROUTE_LOCAL;
+    } else if (route) {
+      routeKind = ROUTE_NODE;
+      offset = writeBytes(buf, offset, this._encoded(route));
+    }
+    buf[flagsAt] = resultFlags(result) | (routeKind << 1);
+
+    const countAt = offset++;
+    let count = 0;
+    const controlIds = this._config.controlIds;
+    for (let i = 0; i < controlIds.length; i++) {
+      const value = commands[controlIds[i]];
+      if (value === undefined) continue;
+      offset = writeBytes(buf, offset, this._controlIdBytes[i]);
+      const integer = toInteger(value);
+      offset = writeVarint(buf, offset, integer >= 0 ? integer * 2 : -integer * 2 - 1);
+      count++;
+    }
+    buf[countAt] = count;
+
+    buf.writeUInt16LE(offset - start - RECORD_HEADER, start);
+    buf.writeUInt32LE(crc32(buf, start + RECORD_HEADER, offset), start + 2);
+    this._batchLength = offset;
+
+    if (segment.size >= segment.nextIndexAt) {
+      segment.times.push(time);
+      segment.offsets.push(segment.size);
+      segment.nextIndexAt = segment.size + this._config.indexInterval;
+    }
+    segment.size += offset - start;
+    segment.lastTime = time;
+    metrics.records.inc();
+
+    if (!this._flushTimer) {
+      this._flushTimer = setTimeout(() => {
+        this._flushTimer = null;
+        this._queueBatch(false);
+      }, this._config.flushInterval);
+      this._flushTimer.unref?.();
+    }
+  }
+
+  /**
+   * Write all buffered records.
+   * @returns {Promise<void>}
+   */
+  async flush() {
+    this._queueBatch(false);
+    while (this._writing) await this._writing;
+  }
+
+  /**
+   * Read records in a time range, oldest first. Only the segments that
+   * overlap the range are opened, from the nearest index entry.
+   * @param {number} from - Start time (ms since epoch, inclusive)
+   * @param {number} to - End time (ms since epoch, inclusive)
+   * @param {number} [limit=1000] - Max records returned
+   * @returns {Promise<{ records: Array<Object>, truncated: boolean }>} Records have ISO `time`,
+   *   `originator`, `route` ('local', a node id or 'none'), `controls`, `latencyMs`, `success` and
+   *   `result` ('written', 'failed', 'superseded' or 'dropped')
+   */
+  async query(from, to, limit = 1000) {
+    await this.flush();
+    while (this._compaction) await this._compaction;
+
+    this._readers++;
+    try {
+      const records = [];
+      for (const segment of this._segments.slice()) {
+        if (segment.flushedSize <= FILE_HEADER || segment.lastTime < from || segment.firstTime > to) continue;
+        if (await this._readSegment(segment, from, to, limit, records)) break;
+      }
+      const truncated = records.length > limit;
+      if (truncated) records.length = limit;
+      for (const record of records) record.time = new Date(record.time).toISOString();
+      return { records, truncated };
+    } finally {
+      this._readers--;
+    }
+  }
+
+  /**
+   * Apply retention and merge small sealed segments. Skipped while a query
+   * is reading; runs on compactInterval and once at startup.
+   * @returns {Promise<void>}
+   */
+  compact() {
+    if (this._compaction || this._readers > 0 || this._closed) return this._compaction || Promise.resolve();
+    this._compaction = this._compact()
+      .catch((err) => {
+        this._logger.error('Compaction failed', { error: err.message });
+      })
+      .finally(() => {
+        this._compaction = null;
+      });
+    return this._compaction;
+  }
+
+  /**
+   * Stop compaction, write buffered records and seal the active segment.
+   * @returns {Promise<void>}
+   */
+  async close() {
+    if (this._closed) return;
+    clearInterval(this._compactTimer);
+    if (this._active) this._queueBatch(true);
+    this._closed = true;
+    this._active = null;
+    while (this._writing) await this._writing;
+    while (this._compaction) await this._compaction;
+  }
+
+  /**
+   * Journal size and range.
+   * @returns {{ segments: number, bytes: number, from: number|null, to: number|null }}
+   */
+  getStats() {
+    const first = this._segments[0];
+    const last = this._segments[this._segments.length - 1];
+    return {
+      segments: this._segments.length,
+      bytes: this._segments.reduce((total, segment) => total + segment.size, 0),
+      from: first ? first.firstTime : null,
+      to: last ? last.lastTime : null,
+    };
+  }
+
+  _encoded(value) {
+    let bytes = this._strings.get(value);
+    if (!bytes) {
+      if (this._strings.size >= STRING_CACHE_SIZE) this._strings.clear();
+      bytes = encodeString(value);
+      this._strings.set(value, bytes);
+    }
+    return bytes;
+  }
+
+  _logPath(seq) {
+    return path.join(this._config.dir, `${String(seq).padStart(8, '0')}.log`);
+  }
+
+  _idxPath(seq) {
+    return path.join(this._config.dir, `${String(seq).padStart(8, '0')}.idx`);
+  }
+
+  /**
+   * Seal the active segment and start a new one whose batch begins with
+   * the file header.
+   */
+  _roll(time) {
+    if (this._active) this._queueBatch(true);
+
+    const seq = ++this._lastSeq;
+    const segment = {
+      seq,
+      coversFrom: seq,
+      size: FILE_HEADER,
+      flushedSize: 0,
+      times: [],
+      offsets: [],
+      indexWritten: 0,
+      nextIndexAt: FILE_HEADER,
+      firstTime: time,
+      lastTime: time,
+      sealed: false,
+      failed: false,
+      fd: null,
+      idxFd: null,
+    };
+    fileHeader(LOG_MAGIC, seq).copy(this._batch, this._batchLength);
+    this._batchLength += FILE_HEADER;
+    this._segments.push(segment);
+    this._active = segment;
+    return segment;
+  }
+
+  /**
+   * Hand the current batch to the writer.
+   * @param {boolean} seal - Close the segment after this batch
+   */
+  _queueBatch(seal) {
+    if (this._flushTimer) {
+      clearTimeout(this._flushTimer);
+      this._flushTimer = null;
+    }
+    const segment = this._active;
+    if (!segment || (this._batchLength === 0 && !seal)) return;
+
+    this._queue.push({
+      segment,
+      data: this._batch.subarray(0, this._batchLength),
+      indexEnd: segment.times.length,
+      seal,
+    });
+    this._batch = Buffer.allocUnsafe(BATCH_SIZE);
+    this._batchLength = 0;
+    this._drain();
+  }
+
+  _drain() {
+    if (this._writing) return;
+    this._writing = (async () => {
+      while (this._queue.length > 0) {
+        const chunk = this._queue.shift();
+        if (chunk.segment.failed) continue;
+        try {
+          await this._writeChunk(chunk);
+        } catch (err) {
+          // Later batches of this segment would land at the wrong offsets;
+          // drop them and continue in a new segment
+          chunk.segment.failed = true;
+          metrics.writeFailures.inc();
+          this._logger.error('Failed to write journal batch', { segment: chunk.segment.seq, error: err.message });
+          await this._closeFiles(chunk.segment);
+          chunk.segment.sealed = true;
+        }
+      }
+    })().finally(() => {
+      this._writing = null;
+      if (this._queue.length > 0) this._drain();
+    });
+  }
+
+  async _writeChunk(chunk) {
+    const { segment } = chunk;
+    let idxHeader = null;
+    if (!segment.fd) {
+      segment.fd = await fs.promises.open(this._logPath(segment.seq), 'a');
+      segment.idxFd = await fs.promises.open(this._idxPath(segment.seq), 'a');
+      idxHeader = fileHeader(IDX_MAGIC, segment.coversFrom);
+    }
+
+    if (chunk.data.length > 0) await segment.fd.write(chunk.data);
+    segment.flushedSize += chunk.data.length;
+
+    // Index entries are written after the records they point to
+    const count = chunk.indexEnd - segment.indexWritten;
+    if (count > 0 || idxHeader) {
+      const headerLength = idxHeader ? FILE_HEADER : 0;
+      const buf = Buffer.allocUnsafe(headerLength + count * INDEX_ENTRY);
+      if (idxHeader) idxHeader.copy(buf, 0);
+      for (let i = 0; i < count; i++) {
+        buf.writeDoubleLE(segment.times[segment.indexWritten + i], headerLength + i * INDEX_ENTRY);
+        buf.writeUInt32LE(segment.offsets[segment.indexWritten + i], headerLength + i * INDEX_ENTRY + 8);
+      }
+      await segment.idxFd.write(buf);
+      segment.indexWritten = chunk.indexEnd;
+    }
+
+    if (chunk.seal) {
+      await segment.fd.sync();
+      await segment.idxFd.sync();
+      await this._closeFiles(segment);
+      segment.sealed = true;
+    }
+  }
+
+  async _closeFiles(segment) {
+    const handles = [segment.fd, segment.idxFd];
+    segment.fd = null;
+    segment.idxFd = null;
+    for (const handle of handles) {
+      if (handle) await handle.close().catch(() => {});
+    }
+  }
+
+  /**
+   * Read the matching records of one segment into `out`.
+   * @returns {Promise<boolean>} True when the range end or limit was reached
+   */
+  async _readSegment(segment, from, to, limit, out) {
+    // Start at the last index entry before the first record at or after `from`
+    let lo = 0;
+    let hi = segment.times.length;
+    while (lo < hi) {
+      const mid = (lo + hi) >>> 1;
+      if (segment.times[mid] < from) lo = mid + 1;
+      else hi = mid;
+    }
+    const start = lo > 0 ? segment.offsets[lo - 1] : FILE_HEADER;
+    const end = segment.flushedSize;
+
+    const handle = await fs.promises.open(this._logPath(segment.seq), 'r');
+    try {
+      const buf = Buffer.allocUnsafe(READ_CHUNK);
+      let position = start;
+      let carry = 0;
+      while (position < end) {
+        const { bytesRead } = await handle.read(buf, carry, Math.min(buf.length - carry, end - position), position);
+        if (bytesRead === 0) break;
+        position += bytesRead;
+        const available = carry + bytesRead;
+        const view = buf.subarray(0, available);
+
+        let offset = 0;
+        while (available - offset >= RECORD_HEADER) {
+          const length = view.readUInt16LE(offset);
+          if (available - offset < RECORD_HEADER + length) break;
+          const record = decodeRecord(view, offset);
+          if (!record) {
+            this._logger.warn('Corrupt journal record, skipping rest of segment', { segment: segment.seq, offset: position - available + offset });
+            return false;
+          }
+          offset += RECORD_HEADER + length;
+          if (record.time < from) continue;
+          if (record.time > to) return true;
+          out.push(record);
+          if (out.length > limit) return true;
+        }
+        buf.copy(buf, 0, offset, available);
+        carry = available - offset;
+      }
+      return false;
+    } finally {
+      await handle.close();
+    }
+  }
+
+  async _compact() {
+    const now = Date.now();
+    let total = this._segments.reduce((sum, segment) => sum + segment.size, 0);
+    let removed = 0;
+    let merged = 0;
+
+    while (this._segments.length > 0 && this._segments[0].sealed) {
+      const oldest = this._segments[0];
+      if (oldest.lastTime >= now - this._config.maxAge && total <= this._config.maxBytes) break;
+      this._segments.shift();
+      total -= oldest.size;
+      await this._removeFiles(oldest.seq);
+      removed++;
+    }
+
+    let i = 0;
+    while (i < this._segments.length - 1) {
+      const a = this._segments[i];
+      const b = this._segments[i + 1];
+      if (a.sealed && b.sealed && !a.failed && !b.failed
+        && a.size + b.size - FILE_HEADER <= this._config.segmentSize) {
+        await this._merge(a, b);
+        this._segments.splice(i, 1);
+        merged++;
+      } else {
+        i++;
+      }
+    }
+
+    if (removed > 0 || merged > 0) {
+      this._logger.info('Journal compacted', { removed, merged, segments: this._segments.length });
+    }
+  }
+
+  /**
+   * Merge sealed segment `a` into the following sealed segment `b`. The
+   * merged log replaces b's atomically and carries a's coversFrom, so if
+   * the process dies before a is deleted, a is discarded on the next start.
+   */
+  async _merge(a, b) {
+    const [dataA, dataB] = await Promise.all([
+      fs.promises.readFile(this._logPath(a.seq)),
+      fs.promises.readFile(this._logPath(b.seq)),
+    ]);
+    const bodyA = dataA.subarray(FILE_HEADER, a.size);
+    const bodyB = dataB.subarray(FILE_HEADER, b.size);
+    const merged = Buffer.concat([fileHeader(LOG_MAGIC, a.coversFrom), bodyA, bodyB]);
+
+    const shift = bodyA.length;
+    const result = {
+      ...b,
+      coversFrom: a.coversFrom,
+      size: merged.length,
+      flushedSize: merged.length,
+      times: a.times.concat(b.times),
+      offsets: a.offsets.concat(b.offsets.map(offset => offset + shift)),
+      firstTime: a.firstTime,
+    };
+    result.indexWritten = result.times.length;
+
+    await writeFileAtomic(this._logPath(b.seq), merged);
+    await writeFileAtomic(this._idxPath(b.seq), encodeIndex(result));
+    await this._removeFiles(a.seq);
+    Object.assign(b, result);
+  }
+
+  async _removeFiles(seq) {
+    for (const file of [this._logPath(seq), this._idxPath(seq)]) {
+      await fs.promises.unlink(file).catch((err) => {
+        if (err.code !== 'ENOENT') throw err;
+      });
+    }
+  }
+
+  /**
+   * Recover segments at startup: drop merge leftovers, repair torn tails
+   * and rebuild missing indexes. Every recovered segment is sealed; new
+   * records go to a new segment.
+   */
+  _load() {
+    const dir = this._config.dir;
+    fs.mkdirSync(dir, { recursive: true });
+
+    const seqs = [];
+    for (const file of fs.readdirSync(dir)) {
+      const match = SEGMENT_FILE.exec(file);
+      if (match) seqs.push(parseInt(match[1], 10));
+      else if (file.endsWith('.tmp')) fs.rmSync(path.join(dir, file), { force: true });
+    }
+    seqs.sort((a, b) => a - b);
+    this._lastSeq = seqs.length > 0 ? seqs[seqs.length - 1] : 0;
+
+    const headers = new Map();
+    for (const seq of seqs) {
+      const fd = fs.openSync(this._logPath(seq), 'r');
+      try {
+        const buf = Buffer.alloc(FILE_HEADER);
+        const bytesRead = fs.readSync(fd, buf, 0, FILE_HEADER, 0);
+        headers.set(seq, bytesRead < FILE_HEADER ? 0 : parseFileHeader(buf, LOG_MAGIC));
+      } finally {
+        fs.closeSync(fd);
+      }
+    }
+
+    for (const seq of seqs) {
+      const coversFrom = headers.get(seq);
+      if (coversFrom === null) {
+        this._logger.warn('Ignoring journal file with unknown format', { file: this._logPath(seq) });
+        continue;
+      }
+      // Empty (torn header), or merged into a later segment
+      const covered = coversFrom === 0
+        || seqs.some(other => other > seq && headers.get(other) && headers.get(other) <= seq);
+      if (covered) {
+        fs.rmSync(this._logPath(seq), { force: true });
+        fs.rmSync(this._idxPath(seq), { force: true });
+        continue;
+      }
+      const segment = this._loadSegment(seq, coversFrom);
+      if (segment) this._segments.push(segment);
+    }
+
+    const last = this._segments[this._segments.length - 1];
+    if (last) this._lastTime = last.lastTime;
+    if (this._segments.length > 0) {
+      this._logger.info('Journal opened', this.getStats());
+    }
+  }
+
+  _loadSegment(seq, coversFrom) {
+    const logPath = this._logPath(seq);
+    const idxPath = this._idxPath(seq);
+    const data = fs.readFileSync(logPath);
+
+    const segment = {
+      seq,
+      coversFrom,
+      size: 0,
+      flushedSize: 0,
+      times: [],
+      offsets: [],
+      indexWritten: 0,
+      nextIndexAt: FILE_HEADER,
+      firstTime: 0,
+      lastTime: 0,
+      sealed: true,
+      failed: false,
+      fd: null,
+      idxFd: null,
+    };
+
+    // Keep index entries that point at whole records, in order
+    let index = null;
+    try {
+      index = fs.readFileSync(idxPath);
+    } catch (err) {
+      if (err.code !== 'ENOENT') throw err;
+    }
+    let rewriteIndex = !index || parseFileHeader(index, IDX_MAGIC) !== coversFrom;
+    if (!rewriteIndex) {
+      const count = Math.floor((index.length - FILE_HEADER) / INDEX_ENTRY);
+      for (let i = 0; i < count; i++) {
+        const time = index.readDoubleLE(FILE_HEADER + i * INDEX_ENTRY);
+        const offset = index.readUInt32LE(FILE_HEADER + i * INDEX_ENTRY + 8);
+        const previous = segment.offsets.length - 1;
+        if (offset >= data.length || (previous >= 0 && (offset <= segment.offsets[previous] || time < segment.times[previous]))) {
+          rewriteIndex = true;
+          break;
+        }
+        segment.times.push(time);
+        segment.offsets.push(offset);
+      }
+      if (index.length !== FILE_HEADER + count * INDEX_ENTRY) rewriteIndex = true;
+    }
+    if (rewriteIndex) {
+      segment.times = [];
+      segment.offsets = [];
+    }
+
+    // Scan from the last index entry: finds the last time, indexes records
+    // the index is missing and stops at a torn tail
+    const indexed = segment.times.length;
+    let scanFrom = FILE_HEADER;
+    if (indexed > 0) {
+      scanFrom = segment.offsets[indexed - 1];
+      segment.nextIndexAt = scanFrom + this._config.indexInterval;
+      segment.times.pop();
+      segment.offsets.pop();
+    }
+    const validEnd = scanRecords(data, scanFrom, (offset, time) => {
+      if (offset >= segment.nextIndexAt || offset === scanFrom) {
+        segment.times.push(time);
+        segment.offsets.push(offset);
+        segment.nextIndexAt = offset + this._config.indexInterval;
+      }
+      segment.lastTime = time;
+    });
+    if (scanFrom > FILE_HEADER && validEnd === scanFrom) {
+      // The last indexed record itself is corrupt; rebuild from the start
+      this._logger.warn('Journal index points at a corrupt record, re-indexing', { file: logPath });
+      fs.rmSync(idxPath, { force: true });
+      return this._loadSegment(seq, coversFrom);
+    }
+
+    if (validEnd <= FILE_HEADER) {
+      fs.rmSync(logPath, { force: true });
+      fs.rmSync(idxPath, { force: true });
+      return null;
+    }
+    if (validEnd < data.length) {
+      this._logger.warn('Truncating torn journal tail', { file: logPath, bytes: data.length - validEnd });
+      fs.truncateSync(logPath, validEnd);
+    }
+    if (rewriteIndex || segment.times.length !== indexed) {
+      writeFileAtomicSync(idxPath, encodeIndex(segment));
+    }
+
+    segment.size = validEnd;
+    segment.flushedSize = validEnd;
+    segment.indexWritten = segment.times.length;
+    segment.firstTime = segment.times[0];
+    return segment;
+  }
+}
+
+module.exports = { CommandJournal };
@@ -1,9 +1,20 @@
 /**
- * UUID format conversion utility.
+ * Shared constants and UUID format conversion utility.
  */
 
+/**
+ * Outcome of a command's first write, as reported by WriteScheduler and
+ * NodePool. Superseded and dropped commands were never sent, unlike failed ones.
+ */
+const WriteResult = Object.freeze({
+  WRITTEN: 'written',
+  FAILED: 'failed',
+  SUPERSEDED: 'superseded', // replaced by a newer coalescing command first
+  DROPPED: 'dropped', // queue full or cleared
+});
+
 function toNobleUuid(uuid) {
   return uuid.replace(/-/g, '').toLowerCase();
 }
 
-module.exports = { toNobleUuid };
+module.exports = { WriteResult, toNobleUuid };
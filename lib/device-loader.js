@@ -8,6 +8,8 @@
 const path = require('path');
 const { toNobleUuid } = require('./constants');
 
+const WRITE_MODES = ['without-response', 'with-response', 'adaptive'];
+
 /**
  * Load and validate a device module by name.
  * @param {string} moduleName - Module name (e.g., "btt-xg"), resolved to devices/<name>
@@ -54,11 +56,37 @@ function loadDeviceModule(moduleName) {
     }
   }
 
+  // Validate optional write mode policy
+  if (deviceModule.writeMode !== undefined && !WRITE_MODES.includes(deviceModule.writeMode)) {
+    throw new Error(`Device module "${moduleName}" has invalid writeMode "${deviceModule.writeMode}" (expected ${WRITE_MODES.join(', ')})`);
+  }
+
   // Validate required function
   if (typeof deviceModule.buildCommand !== 'function') {
     throw new Error(`Device module "${moduleName}" must export a buildCommand function`);
   }
 
+  // Validate optional requests; buildBatteryRequest() is the older form of requests.battery
+  const requests = { ...(deviceModule.requests || {}) };
+  if (!requests.battery && typeof deviceModule.buildBatteryRequest === 'function') {
+    requests.battery = {
+      build: () => deviceModule.buildBatteryRequest(),
+      match: result => result.type === 'battery',
+    };
+  }
+  for (const [name, request] of Object.entries(requests)) {
+    if (typeof request.build !== 'function' || typeof request.match !== 'function') {
+      throw new Error(`Device module "${moduleName}": request "${name}" must have build and match functions`);
+    }
+  }
+  if (Object.keys(requests).length > 0 && typeof deviceModule.parseNotification !== 'function') {
+    throw new Error(`Device module "${moduleName}" has requests but no parseNotification function to match answers`);
+  }
+  deviceModule.requests = requests;
+
+  // Lets a worker thread load the same module (ble.isolate)
+  deviceModule._moduleName = moduleName;
+
   // Attach computed noble-format UUIDs
   deviceModule._nobleUuids = {
     service: toNobleUuid(deviceModule.serviceUuid),
@@ -69,4 +97,4 @@ function loadDeviceModule(moduleName) {
   return deviceModule;
 }
 
-module.exports = { loadDeviceModule };
+module.exports = { loadDeviceModule, WRITE_MODES };
@@ -0,0 +1,218 @@
+/**
+ * Bounded, aging table of sighted devices.
+ *
+ * Keyed by address (or any id, e.g. a node id in handoff elections). Each
+ * entry keeps a window of its most recent RSSI samples plus first- and
+ * last-seen times. Entries are kept in last-seen order, so the oldest is
+ * always at the front: entries not seen within `ttl` are dropped from
+ * there, and when the table is full the least recently seen entry makes
+ * room for a new one. Both are O(1) per sighting, which keeps long or
+ * showAll scans in busy areas at a fixed size with current signal data.
+ *
+ * The caller owns `entry.info` (name, address type, ...), which snapshot()
+ * merges with the signal statistics into a plain object for the API.
+ */
+
+const { registry } = require('./metrics');
+
+const evictions = registry.counter('device_table_evictions_total', 'Device table entries dropped', { labelNames: ['reason'] });
+const metrics = {
+  expired: evictions.labels('ttl'),
+  evicted: evictions.labels('capacity'),
+};
+
+// noble reports 127 when the controller has no RSSI for the advert
+const RSSI_UNAVAILABLE = 127;
+
+class DeviceTable {
+  /**
+   * @param {Object} [config]
+   * @param {number} [config.capacity=1000] - Most entries kept; the least recently seen is evicted beyond it
+   * @param {number} [config.ttl=60000] - Drop entries not seen for this long (ms); 0 keeps them
+   * @param {number} [config.window=16] - RSSI samples per entry that min/max/mean are computed over
+   */
+  constructor(config = {}) {
+    this._config = {
+      capacity: config.capacity || 1000,
+      ttl: config.ttl ?? 60000,
+      window: config.window || 16,
+    };
+    this._entries = new Map(); // key -> entry, least recently seen first
+  }
+
+  /**
+   * Number of entries, including any that expired but were not yet pruned.
+   * @returns {number}
+   */
+  get size() {
+    return this._entries.size;
+  }
+
+  /**
+   * Record a sighting, creating the entry if needed.
+   * @param {string} key - Device address or other id
+   * @param {number} [rssi] - RSSI in dBm; sightings without one only refresh last-seen
+   * @param {number} [now=Date.now()]
+   * @returns {Object} The entry; `entry.info` is null on the first sighting
+   */
+  observe(key, rssi, now = Date.now()) {
+    let entry = this._entries.get(key);
+    if (entry !== undefined) {
+      // Move to the back: last-seen order
+      this._entries.delete(key);
+    } else {
+      this._makeRoom(now);
+      entry = {
+        key,
+        info: null,
+        firstSeen: now,
+        lastSeen: now,
+        rssi: null,
+        count: 0,
+        samples: new Int8Array(this._config.window),
+      };
+    }
+    this._entries.set(key, entry);
+    entry.lastSeen = now;
+    if (typeof rssi === 'number' && rssi !== RSSI_UNAVAILABLE) {
+      entry.samples[entry.count % entry.samples.length] = rssi;
+      entry.count++;
+      entry.rssi = rssi;
+    }
+    return entry;
+  }
+
+  /**
+   * An entry as a structured-cloneable record, e.g. to post to another thread.
+   * @param {Object} entry
+   * @returns {Object} Input for importEntry()
+   */
+  exportEntry(entry) {
+    const { key, info, firstSeen, lastSeen, rssi, count } = entry;
+    return { key, info, firstSeen, lastSeen, rssi, count, samples: entry.samples.slice() };
+  }
+
+  /**
+   * Insert or replace an entry from exportEntry(), as the latest sighting.
+   * @param {Object} record
+   * @returns {Object} The entry
+   */
+  importEntry(record) {
+    if (!this._entries.delete(record.key)) this._makeRoom(record.lastSeen);
+    const entry = { ...record };
+    this._entries.set(entry.key, entry);
+    return entry;
+  }
+
+  /**
+   * Look up a live entry.
+   * @param {string} key
+   * @param {number} [now=Date.now()]
+   * @returns {Object|undefined}
+   */
+  get(key, now = Date.now()) {
+    const entry = this._entries.get(key);
+    if (entry === undefined) return undefined;
+    if (this._isExpired(entry, now)) {
+      this._prune(now);
+      return undefined;
+    }
+    return entry;
+  }
+
+  /**
+   * @param {string} key
+   * @returns {boolean} Whether an entry was removed
+   */
+  delete(key) {
+    return this._entries.delete(key);
+  }
+
+  clear() {
+    this._entries.clear();
+  }
+
+  /**
+   * Live entries, least recently seen first.
+   * @param {number} [now=Date.now()]
+   * @returns {Array<Object>}
+   */
+  entries(now = Date.now()) {
+    this._prune(now);
+    return Array.from(this._entries.values());
+  }
+
+  /**
+   * Plain objects for every live entry, see snapshot().
+   * @param {number} [now=Date.now()]
+   * @returns {Array<Object>}
+   */
+  list(now = Date.now()) {
+    return this.entries(now).map(entry => this.snapshot(entry));
+  }
+
+  /**
+   * An entry's info merged with its signal statistics.
+   * @param {Object} entry
+   * @returns {Object} `{ ...info, rssi, rssiStats: { min, max, mean, count }, timestamp, lastSeen }`;
+   *   min/max/mean cover the last `window` samples, count all of them, times are ISO strings
+   */
+  snapshot(entry) {
+    return {
+      ...entry.info,
+      rssi: entry.rssi,
+      rssiStats: DeviceTable.rssiStats(entry),
+      timestamp: new Date(entry.firstSeen).toISOString(),
+      lastSeen: new Date(entry.lastSeen).toISOString(),
+    };
+  }
+
+  /**
+   * RSSI statistics over an entry's sample window.
+   * @param {Object} entry
+   * @returns {{ min: number|null, max: number|null, mean: number|null, count: number }}
+   */
+  static rssiStats(entry) {
+    const n = Math.min(entry.count, entry.samples.length);
+    if (n === 0) return { min: null, max: null, mean: null, count: 0 };
+    let min = Infinity;
+    let max = -Infinity;
+    let sum = 0;
+    for (let i = 0; i < n; i++) {
+      const value = entry.samples[i];
+      if (value < min) min = value;
+      if (value > max) max = value;
+      sum += value;
+    }
+    return { min, max, mean: Math.round((sum / n) * 10) / 10, count: entry.count };
+  }
+
+  _isExpired(entry, now) {
+    return this._config.ttl > 0 && now - entry.lastSeen > this._config.ttl;
+  }
+
+  /**
+   * Prune, then evict the least recently seen entry if still full.
+   */
+  _makeRoom(now) {
+    this._prune(now);
+    if (this._entries.size >= this._config.capacity) {
+      this._entries.delete(this._entries.keys().next().value);
+      metrics.evicted.inc();
+    }
+  }
+
+  /**
+   * Drop expired entries from the front (the least recently seen).
+   */
+  _prune(now) {
+    if (this._config.ttl <= 0) return;
+    for (const entry of this._entries.values()) {
+      if (!this._isExpired(entry, now)) return;
+      this._entries.delete(entry.key);
+      metrics.expired.inc();
+    }
+  }
+}
+
+module.exports = { DeviceTable };
@@ -0,0 +1,166 @@
+/**
+ * Persistent discovery cache.
+ *
+ * Remembers, per adapter and device module, the peripheral a connection
+ * last succeeded with: identifier, address, address type, local name and
+ * last RSSI. BleDevice tries a direct connect to the cached peripheral
+ * before scanning, so a restart (or a reconnect on macOS/Windows) does not
+ * wait for a scan to find a device it already knows. Entries expire after
+ * `ttl`, and a failed direct connect invalidates its entry.
+ *
+ * The cache lives in memory; changes are written behind to a JSON file
+ * with atomic replacement.
+ *
+ * File format:
+ *   { "version": 1, "entries": { "<adapter>|<module>": { id, address, addressType, name, rssi, seenAt } } }
+ */
+
+const fs = require('fs');
+const { WriteBehindFile } = require('./write-behind-file');
+const { registry } = require('./metrics');
+
+const FORMAT_VERSION = 1;
+
+const metrics = {
+  hits: registry.counter('discovery_cache_hits_total', 'Connects that found a cached peripheral'),
+  misses: registry.counter('discovery_cache_misses_total', 'Connects with no usable cached peripheral'),
+  invalidations: registry.counter('discovery_cache_invalidations_total', 'Cached peripherals dropped after a failed direct connect'),
+};
+
+class DiscoveryCache {
+  /**
+   * @param {Object} config
+   * @param {string} config.path - Backing JSON file
+   * @param {number} [config.ttl=604800000] - Entries older than this are ignored (ms, default 7 days)
+   * @param {number} [config.debounce=1000] - Delay before changes are written (ms)
+   * @param {Object} logger - Logger instance
+   */
+  constructor(config, logger) {
+    this._config = {
+      path: config.path,
+      ttl: config.ttl || 7 * 24 * 60 * 60 * 1000,
+      debounce: config.debounce ?? 1000,
+    };
+    this._logger = logger.child('discovery-cache');
+
+    this._entries = new Map(); // "<adapter>|<module>" -> entry
+    this._file = new WriteBehindFile({
+      path: this._config.path,
+      debounce: this._config.debounce,
+      unref: true,
+      serialize: () => this._serialize(),
+      onError: (err) => this._logger.error('Failed to write discovery cache', { error: err.message }),
+    });
+    this._stats = { hits: 0, misses: 0, invalidations: 0 };
+
+    this._load();
+  }
+
+  /**
+   * The cached peripheral for a key, if any and not expired. Counts a hit or miss.
+   * @param {string} key - "<adapter>|<module>"
+   * @returns {{ id: string, address: string, addressType: string, name: string, rssi: number, seenAt: number }|null}
+   */
+  lookup(key) {
+    const entry = this._entries.get(key);
+    if (entry && Date.now() - entry.seenAt <= this._config.ttl) {
+      this._stats.hits++;
+      metrics.hits.inc();
+      return entry;
+    }
+    if (entry) {
+      this._entries.delete(key);
+      this._scheduleWrite();
+    }
+    this._stats.misses++;
+    metrics.misses.inc();
+    return null;
+  }
+
+  /**
+   * Remember the peripheral a connection succeeded with.
+   * @param {string} key
+   * @param {Object} peripheral - { id, address, addressType, name, rssi }
+   */
+  record(key, peripheral) {
+    this._entries.set(key, {
+      id: peripheral.id || '',
+      address: peripheral.address || '',
+      addressType: peripheral.addressType || 'public',
+      name: peripheral.name || '',
+      rssi: typeof peripheral.rssi === 'number' ? peripheral.rssi : null,
+      seenAt: Date.now(),
+    });
+    this._scheduleWrite();
+  }
+
+  /**
+   * Forget a cached peripheral, e.g. after a failed direct connect.
+   * @param {string} key
+   */
+  invalidate(key) {
+    if (!this._entries.delete(key)) return;
+    this._stats.invalidations++;
+    metrics.invalidations.inc();
+    this._scheduleWrite();
+  }
+
+  /**
+   * Hit, miss and invalidation counts since startup.
+   * @returns {{ hits: number, misses: number, invalidations: number, entries: number }}
+   */
+  getStats() {
+    return { ...this._stats, entries: this._entries.size };
+  }
+
+  /**
+   * Write pending changes now.
+   * @returns {Promise<void>}
+   */
+  flush() {
+    return this._file.flush();
+  }
+
+  /**
+   * Write pending changes (shutdown), after any write already in flight.
+   * @returns {Promise<void>}
+   */
+  close() {
+    return this.flush();
+  }
+
+  _scheduleWrite() {
+    this._file.schedule();
+  }
+
+  _serialize() {
+    return JSON.stringify({ version: FORMAT_VERSION, entries: Object.fromEntries(this._entries) }, null, 2);
+  }
+
+  _load() {
+    let stored;
+    try {
+      stored = JSON.parse(fs.readFileSync(this._config.path, 'utf8'));
+    } catch (err) {
+      if (err.code !== 'ENOENT') {
+        // A cache is only an optimization: start empty rather than fail
+        this._logger.warn('Ignoring unreadable discovery cache', { path: this._config.path, error: err.message });
+      }
+      return;
+    }
+    if (stored?.version !== FORMAT_VERSION || typeof stored.entries !== 'object') {
+      this._logger.warn('Ignoring discovery cache with unknown format', { path: this._config.path });
+      return;
+    }
+
+    const now = Date.now();
+    for (const [key, entry] of Object.entries(stored.entries)) {
+      if (entry && (entry.id || entry.address) && now - entry.seenAt <= this._config.ttl) {
+        this._entries.set(key, entry);
+      }
+    }
+    this._logger.debug('Loaded discovery cache', { entries: this._entries.size });
+  }
+}
+
+module.exports = { DiscoveryCache };
@@ -0,0 +1,127 @@
+/**
+ * Fixed-size log-linear histogram.
+ *
+ * Values are non-negative integers (e.g. microseconds). Values below 32 get
+ * their own bucket; above that each power of two is split into 16 buckets,
+ * so any recorded value is reported within about 6% of its true value.
+ * Buckets are preallocated, so record() never allocates.
+ */
+
+const LINEAR_BUCKETS = 32;
+const SUB_BUCKETS = 16;
+const MAX_EXPONENT = 31;
+const BUCKET_COUNT = LINEAR_BUCKETS + (MAX_EXPONENT - 5 + 1) * SUB_BUCKETS;
+
+/**
+ * Bucket index for a value.
+ * @param {number} value - Non-negative integer below 2^32
+ * @returns {number}
+ */
+function bucketIndex(value) {
+  if (value < LINEAR_BUCKETS) return value;
+  const exponent = 31 - Math.clz32(value);
+  const shift = exponent - 4;
+  return LINEAR_BUCKETS + (exponent - 5) * SUB_BUCKETS + ((value >>> shift) - SUB_BUCKETS);
+}
+
+/**
+ * Highest value that falls into a bucket.
+ * @param {number} index
+ * @returns {number}
+ */
+function bucketUpperBound(index) {
+  if (index < LINEAR_BUCKETS) return index;
+  const exponent = Math.floor((index - LINEAR_BUCKETS) / SUB_BUCKETS) + 5;
+  const sub = (index - LINEAR_BUCKETS) % SUB_BUCKETS + SUB_BUCKETS;
+  const shift = exponent - 4;
+  return ((sub + 1) * 2 ** shift) - 1;
+}
+
+class Histogram {
+  constructor() {
+    this._counts = new Float64Array(BUCKET_COUNT);
+    this.reset();
+  }
+
+  /**
+   * Record a value. Negative values count as 0, values are rounded and
+   * capped at 2^32 - 1.
+   * @param {number} value
+   */
+  record(value) {
+    const v = value > 0 ? Math.min(Math.round(value), 0xFFFFFFFF) : 0;
+    this._counts[bucketIndex(v)]++;
+    this.count++;
+    this.sum += v;
+    if (v < this.min) this.min = v;
+    if (v > this.max) this.max = v;
+  }
+
+  /**
+   * Value at a percentile (upper bound of the bucket holding it).
+   * @param {number} p - Percentile in [0, 100]
+   * @returns {number} 0 when empty
+   */
+  percentile(p) {
+    if (this.count === 0) return 0;
+    const rank = Math.max(1, Math.ceil((p / 100) * this.count));
+    let seen = 0;
+    for (let i = 0; i < BUCKET_COUNT; i++) {
+      seen += this._counts[i];
+      if (seen >= rank) return Math.min(bucketUpperBound(i), this.max);
+    }
+    return this.max;
+  }
+
+  /**
+   * Number of recorded values less than or equal to a bound.
+   * Exact at bucket boundaries, approximate (bucket resolution) in between.
+   * @param {number} bound
+   * @returns {number}
+   */
+  countAtOrBelow(bound) {
+    if (bound < 0) return 0;
+    const last = bucketIndex(Math.min(Math.floor(bound), 0xFFFFFFFF));
+    let total = 0;
+    for (let i = 0; i <= last; i++) total += this._counts[i];
+    return total;
+  }
+
+  /**
+   * Mean of recorded values.
+   * @returns {number}
+   */
+  get mean() {
+    return this.count ? this.sum / this.count : 0;
+  }
+
+  /**
+   * Summary with values divided by `scale` (e.g. 1000 for µs -> ms).
+   * @param {number} [scale=1]
+   * @returns {{ count: number, mean: number, p50: number, p90: number, p99: number, max: number }}
+   */
+  summary(scale = 1) {
+    const round = v => Math.round((v / scale) * 100) / 100;
+    return {
+      count: this.count,
+      mean: round(this.mean),
+      p50: round(this.percentile(50)),
+      p90: round(this.percentile(90)),
+      p99: round(this.percentile(99)),
+      max: round(this.count ? this.max : 0),
+    };
+  }
+
+  /**
+   * Discard all recorded values.
+   */
+  reset() {
+    this._counts.fill(0);
+    this.count = 0;
+    this.sum = 0;
+    this.min = Infinity;
+    this.max = 0;
+  }
+}
+
+module.exports = { Histogram };
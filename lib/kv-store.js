@@ -0,0 +1,249 @@
+/**
+ * Persistent key-value store with write-behind.
+ *
+ * The in-memory state is authoritative: get() and set() never touch the
+ * disk. Changes are persisted after a short debounce with an atomic write
+ * (temp file, fsync, rename), and the file is watched so external edits are
+ * picked up without a restart.
+ *
+ * Keys are declared up front with a type and default. Keys with
+ * `resetDaily` go back to their default on the first read of a new local
+ * day; the day is tracked in a companion `<key>Date` field, which keeps the
+ * file format of the original kvStorage.json.
+ */
+
+const fs = require('fs');
+const path = require('path');
+const { EventEmitter } = require('events');
+const { writeFileAtomicSync } = require('./atomic-write');
+const { WriteBehindFile } = require('./write-behind-file');
+
+const TYPES = {
+  number: (value) => {
+    const number = Number(value);
+    return Number.isFinite(number) ? number : undefined;
+  },
+  string: value => (value === undefined || value === null ? undefined : String(value)),
+  boolean: value => (typeof value === 'boolean' ? value : undefined),
+};
+
+class KvStore extends EventEmitter {
+  /**
+   * @param {Object} options
+   * @param {string} options.path - Backing JSON file
+   * @param {Object} options.keys - key -> { type='number', default, resetDaily=false }
+   * @param {number} [options.debounce=250] - Delay before changes are written (ms)
+   * @param {boolean} [options.watch=true] - Reload when the file is changed externally
+   * @param {Object} logger - Logger instance
+   */
+  constructor(options, logger) {
+    super();
+    this._path = options.path;
+    this._keys = options.keys;
+    this._logger = logger.child('kv');
+
+    this._state = {};
+    this._lastWritten = null; // serialized content of our last write
+    this._file = new WriteBehindFile({
+      path: this._path,
+      debounce: options.debounce ?? 250,
+      serialize: () => this._serialize(),
+      onWrite: (content) => {
+        this._lastWritten = content;
+      },
+      onError: (err) => this._logger.error('Failed to persist values', { error: err.message }),
+    });
+    this._watcher = null;
+    this._reloadTimer = null;
+
+    for (const [key, spec] of Object.entries(this._keys)) {
+      if (!TYPES[spec.type || 'number']) throw new Error(`Unknown type for key "${key}": ${spec.type}`);
+    }
+
+    this._load();
+    if (options.watch !== false) this._watch();
+  }
+
+  /**
+   * Read a value, applying its daily reset.
+   * @param {string} key
+   * @returns {*} Value, or null for an undeclared key
+   */
+  get(key) {
+    const spec = this._keys[key];
+    if (!spec) return null;
+
+    if (spec.resetDaily && !isToday(this._state[`${key}Date`])) {
+      this._state[key] = spec.default;
+      this._state[`${key}Date`] = new Date().toISOString();
+      this._scheduleWrite();
+    }
+    return this._state[key];
+  }
+
+  /**
+   * Set a value. It is persisted asynchronously.
+   * @param {string} key
+   * @param {*} value - Coerced to the key's type
+   * @throws {Error} For undeclared keys or values that do not fit the type
+   */
+  set(key, value) {
+    const spec = this._keys[key];
+    if (!spec) throw new Error(`Unknown key "${key}"`);
+
+    const coerced = TYPES[spec.type || 'number'](value);
+    if (coerced === undefined) throw new TypeError(`Invalid ${spec.type || 'number'} for "${key}": ${value}`);
+
+    this._state[key] = coerced;
+    if (spec.resetDaily) this._state[`${key}Date`] = new Date().toISOString();
+    this._scheduleWrite();
+  }
+
+  /**
+   * Write pending changes now.
+   * @returns {Promise<void>}
+   */
+  flush() {
+    return this._file.flush();
+  }
+
+  /**
+   * Stop watching and write pending changes (shutdown). Waits for a write
+   * already in flight first, so it cannot land after the final state.
+   * @returns {Promise<void>}
+   */
+  async close() {
+    if (this._watcher) {
+      this._watcher.close();
+      this._watcher = null;
+    }
+    clearTimeout(this._reloadTimer);
+    await this.flush();
+  }
+
+  _scheduleWrite() {
+    this._file.schedule();
+  }
+
+  _serialize() {
+    return JSON.stringify(this._state, null, 2);
+  }
+
+  _defaults() {
+    const state = {};
+    const now = new Date().toISOString();
+    for (const [key, spec] of Object.entries(this._keys)) {
+      state[key] = spec.default;
+      if (spec.resetDaily) state[`${key}Date`] = now;
+    }
+    return state;
+  }
+
+  /**
+   * Merge file content over the declared defaults, dropping values of the
+   * wrong type.
+   * @param {Object} stored
+   * @returns {Object}
+   */
+  _sanitize(stored) {
+    const state = this._defaults();
+    for (const [key, value] of Object.entries(stored || {})) {
+      const spec = this._keys[key];
+      if (spec) {
+        const coerced = TYPES[spec.type || 'number'](value);
+        if (coerced !== undefined) state[key] = coerced;
+      } else {
+        state[key] = value; // date stamps and unknown keys are kept as-is
+      }
+    }
+    return state;
+  }
+
+  _load() {
+    let content = null;
+    try {
+      content = fs.readFileSync(this._path, 'utf8');
+    } catch (err) {
+      if (err.code !== 'ENOENT') throw err;
+    }
+
+    if (content === null) {
+      this._state = this._defaults();
+      this._lastWritten = this._serialize();
+      writeFileAtomicSync(this._path, this._lastWritten);
+      return;
+    }
+
+    try {
+      this._state = this._sanitize(JSON.parse(content));
+      this._lastWritten = content;
+    } catch (err) {
+      this._logger.warn('Stored values are not valid JSON, using defaults', { error: err.message });
+      this._state = this._defaults();
+      this._scheduleWrite();
+    }
+  }
+
+  _watch() {
+    const dir = path.dirname(this._path);
+    const file = path.basename(this._path);
+    try {
+      // Watch the directory: atomic writes replace the file's inode
+      this._watcher = fs.watch(dir, (event, filename) => {
+        if (filename !== file) return;
+        clearTimeout(this._reloadTimer);
+        this._reloadTimer = setTimeout(() => this._reload(), 50);
+      });
+      this._watcher.on('error', (err) => {
+        this._logger.warn('File watch failed, external edits will not be picked up', { error: err.message });
+      });
+    } catch (err) {
+      this._logger.warn('File watch unavailable, external edits will not be picked up', { error: err.message });
+    }
+  }
+
+  async _reload() {
+    let content;
+    try {
+      content = await fs.promises.readFile(this._path, 'utf8');
+    } catch {
+      return; // replaced or removed mid-write; the next event retries
+    }
+    if (content === this._lastWritten) return; // our own write
+
+    if (this._file.pending) {
+      this._logger.warn('Ignoring external edit while local changes are pending');
+      return;
+    }
+
+    let stored;
+    try {
+      stored = JSON.parse(content);
+    } catch {
+      return; // partially written by an editor; wait for the next event
+    }
+
+    const previous = this._state;
+    this._state = this._sanitize(stored);
+    this._lastWritten = content;
+
+    const changed = Object.keys(this._keys).filter(key => previous[key] !== this._state[key]);
+    if (changed.length > 0) {
+      this._logger.info('Reloaded values after external edit', { changed });
+      this.emit('change', changed);
+    }
+  }
+}
+
+/**
+ * Check whether an ISO timestamp falls on the current local day.
+ * @param {string} iso
+ * @returns {boolean}
+ */
+function isToday(iso) {
+  if (!iso) return false;
+  const date = new Date(iso);
+  return !Number.isNaN(date.getTime()) && date.toDateString() === new Date().toDateString();
+}
+
+module.exports = { KvStore };
@@ -0,0 +1,132 @@
+/**
+ * End-to-end command latency tracing.
+ *
+ * A trace is started when a command arrives (HTTP or Socket.io) and travels
+ * with it through sendCommand, the write queue and either the local BLE
+ * write or the node pool. Each hop stamps a mark on the monotonic clock;
+ * forwarders report their own processing time in command_result, since
+ * their clocks are not comparable with the server's. When the command's
+ * first write completes, the marks are turned into per-stage durations:
+ *
+ *   dispatch  received -> dispatched   validation, logging, command building
+ *   queue     dispatched -> write      write queue / node send window wait
+ *   ble       write -> written         local BLE write
+ *   network   write -> acked, minus node time   WebSocket round trip
+ *   node      reported by the forwarder         receive -> first write done
+ *   total     received -> written/acked
+ */
+
+const { performance } = require('perf_hooks');
+const { Histogram } = require('./histogram');
+const { WriteResult } = require('./constants');
+
+const STAGES = ['dispatch', 'queue', 'ble', 'network', 'node', 'total'];
+
+/**
+ * Stamp a mark on a trace. No-op for a null trace, so callers need not check.
+ * @param {Object|null} trace - Trace from LatencyTracer.begin()
+ * @param {string} name - Mark name
+ */
+function markTrace(trace, name) {
+  if (trace) trace.marks[name] = performance.now();
+}
+
+class LatencyTracer {
+  /**
+   * @param {Object} [options]
+   * @param {boolean} [options.enabled=true] - When false, begin() returns null
+   * @param {number} [options.recent=20] - Number of completed traces kept for inspection
+   */
+  constructor(options = {}) {
+    this._enabled = options.enabled !== false;
+    this._recentLimit = options.recent ?? 20;
+    this._nextId = 0;
+    this._stages = {};
+    for (const stage of STAGES) this._stages[stage] = new Histogram();
+    this._recent = [];
+    this._counts = { started: 0, completed: 0, failed: 0, superseded: 0, dropped: 0 };
+  }
+
+  /**
+   * Start a trace for an incoming command.
+   * @param {string} source - Where the command came from ('http', 'socket', ...)
+   * @returns {Object|null} Trace, or null when tracing is disabled
+   */
+  begin(source) {
+    if (!this._enabled) return null;
+    this._counts.started++;
+    return {
+      id: (++this._nextId).toString(36),
+      source,
+      marks: { received: performance.now() },
+      nodeUs: null,
+    };
+  }
+
+  /**
+   * Complete a trace once the command's first write has finished.
+   * Failed, superseded or dropped commands are counted but not recorded.
+   * @param {Object|null} trace
+   * @param {string} result - WriteResult
+   */
+  finish(trace, result) {
+    if (!trace) return;
+    if (result !== WriteResult.WRITTEN) {
+      if (result === WriteResult.SUPERSEDED) this._counts.superseded++;
+      else if (result === WriteResult.DROPPED) this._counts.dropped++;
+      else this._counts.failed++;
+      return;
+    }
+    this._counts.completed++;
+
+    const { received, dispatched, write, written, acked } = trace.marks;
+    const end = written ?? acked;
+    const stages = {};
+    const record = (stage, ms) => {
+      if (ms === undefined || Number.isNaN(ms)) return;
+      this._stages[stage].record(ms * 1000);
+      stages[stage] = Math.round(ms * 100) / 100;
+    };
+
+    if (dispatched !== undefined) record('dispatch', dispatched - received);
+    if (dispatched !== undefined && write !== undefined) record('queue', write - dispatched);
+    if (written !== undefined && write !== undefined) record('ble', written - write);
+    if (acked !== undefined && write !== undefined) {
+      const nodeMs = trace.nodeUs !== null ? trace.nodeUs / 1000 : 0;
+      record('network', Math.max(0, acked - write - nodeMs));
+      if (trace.nodeUs !== null) record('node', nodeMs);
+    }
+    if (end !== undefined) record('total', end - received);
+
+    if (this._recentLimit > 0) {
+      this._recent.push({ id: trace.id, source: trace.source, path: acked !== undefined ? 'node' : 'local', stages });
+      if (this._recent.length > this._recentLimit) this._recent.shift();
+    }
+  }
+
+  /**
+   * Per-stage latency summaries in milliseconds, counters and recent traces.
+   * @returns {{ enabled: boolean, started: number, completed: number, failed: number, superseded: number, dropped: number, stages: Object, recent: Array }}
+   */
+  getStats() {
+    const stages = {};
+    for (const stage of STAGES) stages[stage] = this._stages[stage].summary(1000);
+    return {
+      enabled: this._enabled,
+      ...this._counts,
+      stages,
+      recent: this._recent.slice(),
+    };
+  }
+
+  /**
+   * Clear histograms, counters and recent traces.
+   */
+  reset() {
+    for (const stage of STAGES) this._stages[stage].reset();
+    this._recent = [];
+    this._counts = { started: 0, completed: 0, failed: 0, superseded: 0, dropped: 0 };
+  }
+}
+
+module.exports = { LatencyTracer, markTrace, STAGES };
@@ -1,7 +1,24 @@
 /**
- * Simple logging utility with consistent formatting and log levels.
+ * Logging utility with consistent formatting and log levels.
+ *
+ * Records go into a preallocated ring buffer (served by /api/logs/tail) and
+ * are formatted and written in batches off the calling path, so a burst of
+ * log calls costs a few field stores each. Output is human-readable text or
+ * NDJSON, to stdout/stderr or a file. Child loggers share the ring and the
+ * output, and can have their own level (logging.levels).
+ *
+ * Data arguments may be a function returning the data; it is only called
+ * when the level is enabled. Hot paths can also check isLevelEnabled().
+ * Enabled data is serialized to JSON at the call, so the ring holds no
+ * references: later changes to the object do not alter the record, and
+ * large or circular values are neither kept alive nor served live.
+ *
+ * A logger in a worker thread (Logger.remote) batches its records to the
+ * parent, which adds them to its own ring and output with append().
  */
 
+const fs = require('fs');
+
 const LOG_LEVELS = {
   debug: 0,
   info: 1,
@@ -9,34 +26,257 @@ const LOG_LEVELS = {
   error: 3,
 };
 
-class Logger {
-  constructor(options = {}) {
-    this.level = LOG_LEVELS[options.level] ?? LOG_LEVELS.info;
-    this.prefix = options.prefix || '';
-  }
+const LEVEL_NAMES = Object.keys(LOG_LEVELS);
+
+/**
+ * Shared state of a logger tree: ring buffer, level overrides and output.
+ */
+class LogSink {
+  constructor(options) {
+    this.format = options.format === 'ndjson' ? 'ndjson' : 'text';
+    this.overrides = options.levels || {};
+    this.flushInterval = options.flushInterval ?? 50;
+
+    const size = Math.max(16, options.ringSize || 1000);
+    this.size = size;
+    this.times = new Float64Array(size);
+    this.levels = new Uint8Array(size);
+    this.prefixes = new Array(size).fill('');
+    this.messages = new Array(size).fill('');
+    this.data = new Array(size).fill(undefined); // JSON text
+    this.seq = 0; // total records written to the ring
+    this.flushed = 0; // records already handed to the output
+    this.timer = null;
+    this.timerIsImmediate = false;
 
-  _formatTimestamp() {
-    return new Date().toISOString();
+    this.fd = options.file ? fs.openSync(options.file, 'a') : null;
+    this.fileQueue = [];
+    this.fileWriting = false;
+
+    process.once('exit', () => this.flush(true));
   }
 
-  _formatMessage(level, message, data) {
-    const timestamp = this._formatTimestamp();
-    const prefix = this.prefix ? `[${this.prefix}] ` : '';
-    const dataStr = data !== undefined ? ` ${JSON.stringify(data)}` : '';
-    return `${timestamp} ${level.toUpperCase().padEnd(5)} ${prefix}${message}${dataStr}`;
+  /**
+   * @param {number} level
+   * @param {string} prefix
+   * @param {string} message
+   * @param {string|undefined} data - Data serialized with safeStringify()
+   * @param {number} [time=Date.now()]
+   */
+  push(level, prefix, message, data, time = Date.now()) {
+    // Never overwrite a record that has not been written: a synchronous
+    // burst longer than the ring is written out in one batch here
+    if (this.seq - this.flushed >= this.size) this.flush();
+
+    const slot = this.seq % this.size;
+    this.times[slot] = time;
+    this.levels[slot] = level;
+    this.prefixes[slot] = prefix;
+    this.messages[slot] = message;
+    this.data[slot] = data;
+    this.seq++;
+
+    if (this.seq - this.flushed >= this.size / 2) {
+      // Write out before the ring wraps over unwritten records
+      if (this.timerIsImmediate) return;
+      if (this.timer) clearTimeout(this.timer);
+      this.timer = setImmediate(() => this.flush());
+      this.timerIsImmediate = true;
+    } else if (!this.timer) {
+      this.timer = setTimeout(() => this.flush(), this.flushInterval);
+      this.timer.unref?.();
+    }
   }
 
-  _log(level, message, data) {
-    if (LOG_LEVELS[level] >= this.level) {
-      const formatted = this._formatMessage(level, message, data);
-      if (level === 'error') {
-        console.error(formatted);
-      } else if (level === 'warn') {
-        console.warn(formatted);
+  /**
+   * Format and write all records not written yet.
+   * @param {boolean} [sync=false] - Write synchronously (process exit)
+   */
+  flush(sync = false) {
+    if (this.timer) {
+      if (this.timerIsImmediate) clearImmediate(this.timer);
+      else clearTimeout(this.timer);
+      this.timer = null;
+      this.timerIsImmediate = false;
+    }
+
+    const start = this.flushed;
+    if (start === this.seq) return;
+
+    let out = '';
+    let err = '';
+    for (let seq = start; seq < this.seq; seq++) {
+      const slot = seq % this.size;
+      const line = this.formatRecord(slot) + '\n';
+      // Text output keeps warnings and errors on stderr, as console.warn/error did
+      if (this.fd === null && this.format === 'text' && this.levels[slot] >= LOG_LEVELS.warn) {
+        err += line;
       } else {
-        console.log(formatted);
+        out += line;
       }
     }
+    this.flushed = this.seq;
+
+    this.write(out, err, sync);
+  }
+
+  write(out, err, sync) {
+    if (this.fd !== null) {
+      if (!out) return;
+      if (sync) {
+        for (const chunk of this.fileQueue.splice(0)) fs.writeSync(this.fd, chunk);
+        fs.writeSync(this.fd, out);
+        return;
+      }
+      this.fileQueue.push(out);
+      this.drainFileQueue();
+      return;
+    }
+    if (out) process.stdout.write(out);
+    if (err) process.stderr.write(err);
+  }
+
+  drainFileQueue() {
+    if (this.fileWriting || this.fileQueue.length === 0) return;
+    this.fileWriting = true;
+    const chunk = this.fileQueue.join('');
+    this.fileQueue.length = 0;
+    fs.write(this.fd, chunk, (error) => {
+      this.fileWriting = false;
+      if (error) process.stderr.write(`Log write failed: ${error.message}\n`);
+      this.drainFileQueue();
+    });
+  }
+
+  formatRecord(slot) {
+    const time = new Date(this.times[slot]).toISOString();
+    const level = LEVEL_NAMES[this.levels[slot]];
+    const prefix = this.prefixes[slot];
+    const message = this.messages[slot];
+    const data = this.data[slot];
+
+    if (this.format === 'ndjson') {
+      // data is JSON already: splice it in rather than parse it again
+      let line = `{"time":"${time}","level":"${level}"`;
+      if (prefix) line += `,"logger":${JSON.stringify(prefix)}`;
+      line += `,"msg":${safeStringify(message)}`;
+      if (data !== undefined) line += `,"data":${data}`;
+      return `${line}}`;
+    }
+    const prefixStr = prefix ? `[${prefix}] ` : '';
+    const dataStr = data !== undefined ? ` ${data}` : '';
+    return `${time} ${level.toUpperCase().padEnd(5)} ${prefixStr}${message}${dataStr}`;
+  }
+
+  /**
+   * Most recent records from the ring, oldest first.
+   * @param {Object} [options]
+   * @param {number} [options.limit=100]
+   * @param {string} [options.level] - Minimum level
+   * @param {string} [options.prefix] - Only this logger and its children
+   * @returns {Array<{ time: string, level: string, logger: string, msg: string, data: any }>}
+   */
+  tail(options = {}) {
+    const limit = Math.max(1, Math.min(options.limit || 100, this.size));
+    const minLevel = LOG_LEVELS[options.level] ?? LOG_LEVELS.debug;
+    const prefix = options.prefix || null;
+    const oldest = Math.max(0, this.seq - this.size);
+
+    const entries = [];
+    for (let seq = this.seq - 1; seq >= oldest && entries.length < limit; seq--) {
+      const slot = seq % this.size;
+      if (this.levels[slot] < minLevel) continue;
+      const recordPrefix = this.prefixes[slot];
+      if (prefix && recordPrefix !== prefix && !recordPrefix.startsWith(`${prefix}:`)) continue;
+      entries.push({
+        time: new Date(this.times[slot]).toISOString(),
+        level: LEVEL_NAMES[this.levels[slot]],
+        logger: recordPrefix,
+        msg: this.messages[slot],
+        data: this.data[slot] === undefined ? undefined : JSON.parse(this.data[slot]),
+      });
+    }
+    return entries.reverse();
+  }
+}
+
+/**
+ * Sink of a worker thread logger: records are batched and handed to `send`
+ * as [time, level, prefix, message, data] tuples instead of being written.
+ */
+class RemoteLogSink {
+  constructor(options, send) {
+    this.overrides = options.levels || {};
+    this.flushInterval = options.flushInterval ?? 50;
+    this.send = send;
+    this.records = [];
+    this.timer = null;
+  }
+
+  push(level, prefix, message, data, time = Date.now()) {
+    this.records.push([time, level, prefix, message, data]);
+    if (!this.timer) {
+      this.timer = setTimeout(() => this.flush(), this.flushInterval);
+      this.timer.unref?.();
+    }
+  }
+
+  flush() {
+    clearTimeout(this.timer);
+    this.timer = null;
+    if (this.records.length === 0) return;
+    const records = this.records;
+    this.records = [];
+    this.send(records);
+  }
+
+  tail() {
+    return [];
+  }
+}
+
+/**
+ * @param {*} value
+ * @returns {string|undefined} JSON text, undefined for undefined
+ */
+function safeStringify(value) {
+  try {
+    return JSON.stringify(value);
+  } catch {
+    return '"[unserializable]"';
+  }
+}
+
+class Logger {
+  /**
+   * @param {Object} [options]
+   * @param {string} [options.level='info'] - Minimum level
+   * @param {string} [options.prefix=''] - Logger name shown in brackets
+   * @param {string} [options.format='text'] - 'text' or 'ndjson'
+   * @param {string} [options.file] - Append to this file instead of stdout/stderr
+   * @param {Object} [options.levels] - Per-child level overrides, keyed by prefix (e.g. { "ble": "debug" })
+   * @param {number} [options.ringSize=1000] - Records kept in memory for tail()
+   * @param {number} [options.flushInterval=50] - Max delay before records are written (ms)
+   */
+  constructor(options = {}, sink = null) {
+    this._sink = sink || new LogSink(options);
+    this.prefix = options.prefix || '';
+    this.level = LOG_LEVELS[this._sink.overrides[this.prefix] ?? options.level] ?? LOG_LEVELS.info;
+  }
+
+  /**
+   * Check whether a level would be logged, to skip building expensive data.
+   * @param {string} level
+   * @returns {boolean}
+   */
+  isLevelEnabled(level) {
+    return LOG_LEVELS[level] >= this.level;
+  }
+
+  _log(level, message, data) {
+    const value = LOG_LEVELS[level];
+    if (value < this.level) return;
+    this._sink.push(value, this.prefix, message, safeStringify(typeof data === 'function' ? data() : data));
   }
 
   debug(message, data) {
@@ -57,9 +297,64 @@ class Logger {
 
   child(prefix) {
     return new Logger({
-      level: Object.keys(LOG_LEVELS).find((k) => LOG_LEVELS[k] === this.level),
+      level: LEVEL_NAMES[this.level],
       prefix: this.prefix ? `${this.prefix}:${prefix}` : prefix,
-    });
+    }, this._sink);
+  }
+
+  /**
+   * Recent records from the shared ring buffer, oldest first.
+   * @param {Object} [options] - { limit, level, prefix }
+   * @returns {Array<Object>}
+   */
+  tail(options) {
+    return this._sink.tail(options);
+  }
+
+  /**
+   * Add records logged elsewhere (a worker thread's Logger.remote) to this
+   * logger's ring and output, keeping their time and logger name.
+   * @param {Array<Array>} records - [time, level, prefix, message, data] tuples, data as JSON text
+   */
+  append(records) {
+    for (const [time, level, prefix, message, data] of records) {
+      this._sink.push(level, prefix, message, data, time);
+    }
+  }
+
+  /**
+   * Options for a Logger.remote() that should log like this logger.
+   * @returns {{ level: string, prefix: string, levels: Object }}
+   */
+  remoteOptions() {
+    return { level: LEVEL_NAMES[this.level], prefix: this.prefix, levels: this._sink.overrides };
+  }
+
+  /**
+   * A logger whose records are batched to `send` (e.g. postMessage to the
+   * parent thread) instead of being written.
+   * @param {Object} options - { level, prefix, levels, flushInterval }
+   * @param {Function} send - (records) => void
+   * @returns {Logger}
+   */
+  static remote(options, send) {
+    return new Logger(options, new RemoteLogSink(options, send));
+  }
+
+  /**
+   * Write pending records now.
+   */
+  flush() {
+    this._sink.flush();
+  }
+
+  /**
+   * Ring buffer and output counters.
+   * @returns {{ buffered: number, logged: number, pending: number }}
+   */
+  getStats() {
+    const sink = this._sink;
+    return { buffered: Math.min(sink.seq, sink.size), logged: sink.seq, pending: sink.seq - sink.flushed };
   }
 }
 
@@ -0,0 +1,274 @@
+/**
+ * Minimal Prometheus metrics registry.
+ *
+ * Counters, gauges and histograms rendered in the Prometheus text exposition
+ * format. Labelled series are created once with labels() and kept by the
+ * caller, so recording a value is a plain field update (or a preallocated
+ * bucket increment for histograms) and never allocates. Gauges can instead
+ * be given a collector that is read at scrape time.
+ *
+ * Histograms record into a log-linear Histogram (lib/histogram.js) in
+ * microseconds; the cumulative `le` buckets are derived at scrape time, so
+ * bucket counts have the histogram's resolution (~6%).
+ *
+ * Metrics recorded in a worker thread reach the process registry as
+ * rendered text through include().
+ */
+
+const { Histogram } = require('./histogram');
+
+const DEFAULT_BUCKETS = [0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30];
+
+function escapeLabelValue(value) {
+  return String(value).replace(/\\/g, '\\\\').replace(/\n/g, '\\n').replace(/"/g, '\\"');
+}
+
+function escapeHelp(help) {
+  return help.replace(/\\/g, '\\\\').replace(/\n/g, '\\n');
+}
+
+function formatValue(value) {
+  if (value === Infinity) return '+Inf';
+  if (value === -Infinity) return '-Inf';
+  return String(value);
+}
+
+class CounterSeries {
+  constructor() {
+    this.value = 0;
+  }
+
+  /**
+   * @param {number} [amount=1] - Non-negative increment
+   */
+  inc(amount = 1) {
+    this.value += amount;
+  }
+}
+
+class GaugeSeries {
+  constructor() {
+    this.value = 0;
+  }
+
+  set(value) {
+    this.value = value;
+  }
+
+  inc(amount = 1) {
+    this.value += amount;
+  }
+
+  dec(amount = 1) {
+    this.value -= amount;
+  }
+}
+
+class HistogramSeries {
+  constructor() {
+    this._histogram = new Histogram();
+  }
+
+  /**
+   * @param {number} seconds - Observed duration in seconds
+   */
+  observe(seconds) {
+    this._histogram.record(seconds * 1e6);
+  }
+}
+
+const SERIES_TYPES = {
+  counter: CounterSeries,
+  gauge: GaugeSeries,
+  histogram: HistogramSeries,
+};
+
+class MetricFamily {
+  constructor(type, name, help, options = {}) {
+    this.type = type;
+    this.name = name;
+    this.help = help;
+    this._labelNames = options.labelNames || [];
+    this._buckets = options.buckets || DEFAULT_BUCKETS;
+    this._series = new Map(); // label key -> { labels, series }
+    this._collector = null;
+    this._default = this._labelNames.length === 0 ? this.labels() : null;
+  }
+
+  /**
+   * Get or create the series for a set of label values. Call once during
+   * setup and keep the result; the lookup itself is not allocation-free.
+   * @param {...string} values - One value per label name, in order
+   * @returns {CounterSeries|GaugeSeries|HistogramSeries}
+   */
+  labels(...values) {
+    if (values.length !== this._labelNames.length) {
+      throw new Error(`Metric ${this.name} expects labels: ${this._labelNames.join(', ')}`);
+    }
+    const key = values.join('\u0000');
+    let entry = this._series.get(key);
+    if (!entry) {
+      const labels = this._labelNames.map((name, i) => `${name}="${escapeLabelValue(values[i])}"`).join(',');
+      entry = { labels, series: new SERIES_TYPES[this.type]() };
+      this._series.set(key, entry);
+    }
+    return entry.series;
+  }
+
+  /**
+   * Read the value at scrape time instead of recording it (unlabelled gauges).
+   * Replaces any earlier collector.
+   * @param {Function} fn - () => number
+   * @returns {MetricFamily}
+   */
+  collect(fn) {
+    this._collector = fn;
+    return this;
+  }
+
+  inc(amount) {
+    this._default.inc(amount);
+  }
+
+  dec(amount) {
+    this._default.dec(amount);
+  }
+
+  set(value) {
+    this._default.set(value);
+  }
+
+  observe(seconds) {
+    this._default.observe(seconds);
+  }
+
+  /**
+   * Render this family in the text exposition format.
+   * @returns {string}
+   */
+  render() {
+    if (this._collector) {
+      try {
+        this._default.set(this._collector());
+      } catch {
+        // a failing collector keeps its last value
+      }
+    }
+
+    const lines = [`# HELP ${this.name} ${escapeHelp(this.help)}`, `# TYPE ${this.name} ${this.type}`];
+    for (const { labels, series } of this._series.values()) {
+      if (this.type !== 'histogram') {
+        lines.push(`${this.name}${labels ? `{${labels}}` : ''} ${formatValue(series.value)}`);
+        continue;
+      }
+
+      const histogram = series._histogram;
+      const sep = labels ? ',' : '';
+      for (const bound of this._buckets) {
+        const count = histogram.countAtOrBelow(bound * 1e6);
+        lines.push(`${this.name}_bucket{${labels}${sep}le="${bound}"} ${count}`);
+      }
+      lines.push(`${this.name}_bucket{${labels}${sep}le="+Inf"} ${histogram.count}`);
+      lines.push(`${this.name}_sum${labels ? `{${labels}}` : ''} ${histogram.sum / 1e6}`);
+      lines.push(`${this.name}_count${labels ? `{${labels}}` : ''} ${histogram.count}`);
+    }
+    return lines.join('\n');
+  }
+}
+
+class Registry {
+  constructor() {
+    this._families = new Map();
+    this._included = new Set(); // () => exposition text from another registry
+  }
+
+  /**
+   * Append another registry's output (e.g. a worker thread's, posted to this
+   * thread) to render(). Families it contains replace same-named local ones,
+   * which a module loaded in both threads would otherwise report twice.
+   * @param {Function} source - () => string in the text exposition format
+   * @returns {Function} Removes the source again
+   */
+  include(source) {
+    this._included.add(source);
+    return () => this._included.delete(source);
+  }
+
+  /**
+   * Get or create a counter.
+   * @param {string} name - Metric name (conventionally ending in _total)
+   * @param {string} help - Description
+   * @param {Object} [options] - { labelNames }
+   * @returns {MetricFamily}
+   */
+  counter(name, help, options) {
+    return this._getOrCreate('counter', name, help, options);
+  }
+
+  /**
+   * Get or create a gauge.
+   * @param {string} name
+   * @param {string} help
+   * @param {Object} [options] - { labelNames }
+   * @returns {MetricFamily}
+   */
+  gauge(name, help, options) {
+    return this._getOrCreate('gauge', name, help, options);
+  }
+
+  /**
+   * Get or create a histogram of durations in seconds.
+   * @param {string} name - Metric name (conventionally ending in _seconds)
+   * @param {string} help
+   * @param {Object} [options] - { labelNames, buckets }
+   * @returns {MetricFamily}
+   */
+  histogram(name, help, options) {
+    return this._getOrCreate('histogram', name, help, options);
+  }
+
+  /**
+   * Render all metrics in the Prometheus text exposition format.
+   * @returns {string}
+   */
+  render() {
+    const included = [];
+    const shadowed = new Set();
+    for (const source of this._included) {
+      const text = source();
+      if (!text) continue;
+      included.push(text.trimEnd());
+      for (const match of text.matchAll(/^# TYPE (\S+)/gm)) shadowed.add(match[1]);
+    }
+
+    const blocks = [];
+    for (const family of this._families.values()) {
+      if (!shadowed.has(family.name)) blocks.push(family.render());
+    }
+    return blocks.concat(included).join('\n') + '\n';
+  }
+
+  /**
+   * Content-Type header for render() output.
+   * @returns {string}
+   */
+  get contentType() {
+    return 'text/plain; version=0.0.4; charset=utf-8';
+  }
+
+  _getOrCreate(type, name, help, options) {
+    const existing = this._families.get(name);
+    if (existing) {
+      if (existing.type !== type) throw new Error(`Metric ${name} already registered as ${existing.type}`);
+      return existing;
+    }
+    const family = new MetricFamily(type, name, help, options);
+    this._families.set(name, family);
+    return family;
+  }
+}
+
+// Process-wide registry shared by all modules
+const registry = new Registry();
+
+module.exports = { Registry, registry, DEFAULT_BUCKETS };
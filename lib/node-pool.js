@@ -3,25 +3,156 @@
  *
  * Manages a pool of forwarder nodes connected via WebSocket. Only one node
  * holds the BLE connection at any time. Implements scan-based handoff when
- * the active node loses its BLE connection.
+ * the active node loses its BLE connection, and proactive handoff when a
+ * standby node's tracked RSSI clearly beats the active node's.
  */
 
 const { EventEmitter } = require('events');
+const { performance } = require('perf_hooks');
 const {
   MSG_STATUS,
   MSG_SCAN_RESULT,
+  MSG_SCAN_SIGHTING,
   MSG_BATTERY,
   MSG_RSSI,
+  MSG_RSSI_SAMPLE,
   MSG_COMMAND_RESULT,
   MSG_COMMAND,
+  MSG_SEQUENCE,
+  MSG_COMMAND_SPEC,
   MSG_GET_BATTERY,
   MSG_GET_RSSI,
   MSG_SCAN,
+  MSG_SCAN_CANCEL,
   MSG_CONNECT,
   MSG_DISCONNECT_BLE,
-  parseMessage,
+  CAP_BINARY,
+  CAP_SEQUENCE,
+  CAP_COMMAND_SPEC,
   formatMessage,
+  formatBinaryMessage,
+  hasBinaryForm,
+  decodeFrame,
 } = require('./node-protocol');
+const { TimerWheel } = require('./timer-wheel');
+const { markTrace } = require('./latency-tracer');
+const { DeviceTable } = require('./device-table');
+const { WriteResult } = require('./constants');
+const { registry } = require('./metrics');
+
+const metrics = {
+  nodes: registry.gauge('nodepool_nodes', 'Connected forwarder nodes'),
+  hasActive: registry.gauge('nodepool_active_node', 'Whether a node holds the BLE connection (1) or not (0)'),
+  pendingCommands: registry.gauge('nodepool_pending_commands', 'Commands in flight or queued for the active node'),
+  handoffDuration: registry.histogram('nodepool_handoff_duration_seconds', 'Time from handoff start to a new active node'),
+  commandTimeouts: registry.counter('nodepool_command_timeouts_total', 'Node commands that timed out waiting for an ack'),
+  commandsSent: registry.counter('nodepool_commands_sent_total', 'Commands sent to nodes'),
+  pingRtt: registry.histogram('nodepool_ping_rtt_seconds', 'WebSocket ping round trip to nodes', {
+    buckets: [0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5],
+  }),
+};
+const handoffs = registry.counter('nodepool_handoffs_total', 'Handoffs started', { labelNames: ['kind'] });
+const scanHandoffs = handoffs.labels('scan');
+const proactiveHandoffs = handoffs.labels('proactive');
+
+/**
+ * Smoothed per-node RSSI tracking and proactive handoff scheduling.
+ *
+ * Each node's rssi_sample stream is smoothed with an EWMA. A standby node
+ * becomes the handoff target once its smoothed RSSI has beaten the active
+ * node's by at least `hysteresis` dB continuously for `sustain` ms.
+ */
+class RssiTracker {
+  /**
+   * @param {Object} options
+   * @param {number} options.alpha - EWMA weight of a new sample (0-1]
+   * @param {number} options.hysteresis - Required margin over the active node (dB)
+   * @param {number} options.sustain - How long the margin must hold (ms)
+   * @param {number} options.staleAfter - Ignore nodes without a sample for this long (ms)
+   */
+  constructor(options) {
+    this._options = options;
+    this._nodes = new Map(); // nodeId -> { smoothed, updatedAt }
+    this._leader = null;
+    this._leadingSince = 0;
+  }
+
+  /**
+   * Fold a raw sample into a node's smoothed value.
+   * @param {string} nodeId
+   * @param {number} value - RSSI in dBm
+   * @param {number} now - Timestamp in ms
+   * @returns {number} Smoothed RSSI
+   */
+  record(nodeId, value, now) {
+    const state = this._nodes.get(nodeId);
+    if (!state || now - state.updatedAt > this._options.staleAfter) {
+      this._nodes.set(nodeId, { smoothed: value, updatedAt: now });
+      return value;
+    }
+    state.smoothed += this._options.alpha * (value - state.smoothed);
+    state.updatedAt = now;
+    return state.smoothed;
+  }
+
+  /**
+   * Get a node's smoothed RSSI, or null if unknown or stale.
+   * @param {string} nodeId
+   * @param {number} now - Timestamp in ms
+   * @returns {number|null}
+   */
+  get(nodeId, now) {
+    const state = this._nodes.get(nodeId);
+    if (!state || now - state.updatedAt > this._options.staleAfter) return null;
+    return state.smoothed;
+  }
+
+  /**
+   * Drop a node's state (disconnect or role change).
+   * @param {string} nodeId
+   */
+  forget(nodeId) {
+    this._nodes.delete(nodeId);
+    if (this._leader === nodeId) this._leader = null;
+  }
+
+  /**
+   * Decide whether to hand off from the active node.
+   * @param {string} activeNodeId
+   * @param {number} now - Timestamp in ms
+   * @returns {string|null} Node to hand off to, or null to stay
+   */
+  evaluate(activeNodeId, now) {
+    const active = this.get(activeNodeId, now);
+    if (active === null) {
+      this._leader = null;
+      return null;
+    }
+
+    let candidate = null;
+    let best = active + this._options.hysteresis;
+    for (const nodeId of this._nodes.keys()) {
+      if (nodeId === activeNodeId) continue;
+      const value = this.get(nodeId, now);
+      if (value !== null && value >= best) {
+        best = value;
+        candidate = nodeId;
+      }
+    }
+
+    if (candidate !== this._leader) {
+      this._leader = candidate;
+      this._leadingSince = now;
+      return null;
+    }
+
+    if (candidate && now - this._leadingSince >= this._options.sustain) {
+      this._leader = null;
+      return candidate;
+    }
+    return null;
+  }
+}
 
 class NodePool extends EventEmitter {
   /**
@@ -30,6 +161,16 @@ class NodePool extends EventEmitter {
    * @param {number} [config.staleTimeout=60000] - Stale node timeout in ms
    * @param {number} [config.scanDuration=10000] - Handoff scan duration in ms
    * @param {number} [config.handoffTimeout=30000] - Handoff retry timeout in ms
+   * @param {number} [config.electionRssi=-60] - Elect immediately on a sighting at or above this RSSI (dBm)
+   * @param {number} [config.electionSettle=500] - Once every node has sighted the device, wait this long (ms) for better samples
+   * @param {boolean} [config.proactiveHandoff=true] - Switch nodes before the link drops based on rssi_sample streams
+   * @param {number} [config.rssiAlpha=0.3] - EWMA weight of a new RSSI sample
+   * @param {number} [config.rssiHysteresis=8] - dB a standby node must beat the active node by
+   * @param {number} [config.rssiSustain=5000] - How long (ms) the margin must hold before switching
+   * @param {number} [config.rssiStale=15000] - Ignore RSSI tracks older than this (ms)
+   * @param {number} [config.commandWindow=8] - Max unacknowledged commands per node
+   * @param {number} [config.commandQueueLimit=64] - Max commands waiting for window space
+   * @param {number} [config.commandTimeout=5000] - Per-command ack timeout in ms
    * @param {Object} logger - Logger instance
    */
   constructor(config, logger) {
@@ -40,6 +181,16 @@ class NodePool extends EventEmitter {
       staleTimeout: config?.staleTimeout || 60000,
       scanDuration: config?.scanDuration || 10000,
       handoffTimeout: config?.handoffTimeout || 30000,
+      electionRssi: config?.electionRssi ?? -60,
+      electionSettle: config?.electionSettle ?? 500,
+      proactiveHandoff: config?.proactiveHandoff !== false,
+      rssiAlpha: config?.rssiAlpha || 0.3,
+      rssiHysteresis: config?.rssiHysteresis ?? 8,
+      rssiSustain: config?.rssiSustain ?? 5000,
+      rssiStale: config?.rssiStale || 15000,
+      commandWindow: config?.commandWindow || 8,
+      commandQueueLimit: config?.commandQueueLimit || 64,
+      commandTimeout: config?.commandTimeout || 5000,
     };
 
     this._logger = logger;
@@ -48,33 +199,58 @@ class NodePool extends EventEmitter {
     this._activeNodeId = null;
     this._handoffInProgress = false;
     this._handoffTimer = null;
-    this._pendingScanResults = null;
+    this._election = null; // { nodes, sightings, finished, startedAt, fallbackTimer, settleTimer }
     this._commandCounter = 0;
-    this._pendingCommands = new Map(); // id -> { resolve, reject, timer }
+    this._commandTimeouts = new TimerWheel({ tickMs: 100 });
+    this._commandStats = { sent: 0, acked: 0, timeouts: 0, dropped: 0 };
+    this._handoffStartedAt = null; // performance.now() when the current handoff began
+    this._telemetryRequests = new Map(); // MSG_GET_BATTERY/MSG_GET_RSSI -> shared in-flight request
+    this._rssiTracker = new RssiTracker({
+      alpha: this._config.rssiAlpha,
+      hysteresis: this._config.rssiHysteresis,
+      sustain: this._config.rssiSustain,
+      staleAfter: this._config.rssiStale,
+    });
+
+    metrics.nodes.collect(() => this._nodes.size);
+    metrics.hasActive.collect(() => (this._activeNodeId ? 1 : 0));
+    metrics.pendingCommands.collect(() => {
+      const active = this.getActiveNode();
+      return active ? active.inFlight.size + active.sendQueue.length : 0;
+    });
   }
 
   /**
    * Add a new authenticated node to the pool.
    * @param {WebSocket} ws - WebSocket connection
    * @param {string} nodeId - Unique node identifier
+   * @param {Object} [options]
+   * @param {string[]} [options.capabilities=[]] - Capabilities negotiated during auth
    * @returns {Object} NodeEntry
    */
-  addNode(ws, nodeId) {
+  addNode(ws, nodeId, options = {}) {
     // Remove existing node with same ID if reconnecting
     if (this._nodes.has(nodeId)) {
       this._poolLogger.info(`Node ${nodeId} reconnecting, removing old entry`);
       this.removeNode(nodeId);
     }
 
+    const capabilities = options.capabilities || [];
     const entry = {
       nodeId,
       ws,
+      capabilities,
+      binary: capabilities.includes(CAP_BINARY),
       bleConnected: false,
       lastBattery: null,
       lastSeen: Date.now(),
       isActive: false,
+      smoothedRssi: null,
       pingTimer: null,
       pongReceived: true,
+      pingSentAt: 0,
+      inFlight: new Map(), // command id -> { data, resolve, timer }
+      sendQueue: [], // commands waiting for window space
     };
 
     // Set up ping/pong
@@ -86,6 +262,7 @@ class NodePool extends EventEmitter {
       }
       entry.pongReceived = false;
       try {
+        entry.pingSentAt = performance.now();
         ws.ping();
       } catch {
         this.removeNode(nodeId);
@@ -93,13 +270,16 @@ class NodePool extends EventEmitter {
     }, this._config.pingInterval);
 
     ws.on('pong', () => {
+      if (!entry.pongReceived && entry.pingSentAt) {
+        metrics.pingRtt.observe((performance.now() - entry.pingSentAt) / 1000);
+      }
       entry.pongReceived = true;
       entry.lastSeen = Date.now();
     });
 
     // Handle incoming messages
-    ws.on('message', (raw) => {
-      const msg = parseMessage(raw.toString());
+    ws.on('message', (raw, isBinary) => {
+      const msg = decodeFrame(raw, isBinary);
       if (!msg) return;
       this._handleNodeMessage(nodeId, msg);
     });
@@ -130,6 +310,8 @@ class NodePool extends EventEmitter {
     if (!entry) return;
 
     if (entry.pingTimer) clearInterval(entry.pingTimer);
+    this._failCommands(entry);
+    this._rssiTracker.forget(nodeId);
 
     try {
       entry.ws.close();
@@ -144,6 +326,9 @@ class NodePool extends EventEmitter {
       this._activeNodeId = null;
       this._poolLogger.warn(`Active node ${nodeId} removed, triggering handoff`);
       this.triggerHandoff();
+    } else if (this._election) {
+      // A node that never reports should not hold up the election
+      this._checkElection();
     }
 
     this._poolLogger.info(`Node ${nodeId} removed from pool (${this._nodes.size} total)`);
@@ -184,8 +369,20 @@ class NodePool extends EventEmitter {
       }
 
       case MSG_SCAN_RESULT: {
-        if (this._pendingScanResults) {
-          this._pendingScanResults.set(nodeId, msg.devices || []);
+        if (this._election) {
+          for (const device of msg.devices || []) {
+            this._recordSighting(nodeId, device.rssi);
+          }
+          this._election.finished.add(nodeId);
+          this._checkElection();
+        }
+        break;
+      }
+
+      case MSG_SCAN_SIGHTING: {
+        if (this._election) {
+          this._recordSighting(nodeId, msg.rssi);
+          this._checkElection();
         }
         break;
       }
@@ -205,13 +402,20 @@ class NodePool extends EventEmitter {
         break;
       }
 
+      case MSG_RSSI_SAMPLE: {
+        if (typeof msg.value !== 'number') break;
+        entry.smoothedRssi = this._rssiTracker.record(nodeId, msg.value, Date.now());
+        this._evaluateProactiveHandoff();
+        break;
+      }
+
       case MSG_COMMAND_RESULT: {
-        const pending = this._pendingCommands.get(msg.id);
-        if (pending) {
-          clearTimeout(pending.timer);
-          this._pendingCommands.delete(msg.id);
-          pending.resolve(msg.success);
-        }
+        // Nodes without result_code only report success or failure
+        const result = Object.values(WriteResult).includes(msg.result)
+          ? msg.result
+          : (msg.success ? WriteResult.WRITTEN : WriteResult.FAILED);
+        // Nodes may acknowledge a contiguous range [from, id] in one message
+        this._ackCommands(entry, msg.from ?? msg.id, msg.id, result, msg.nodeUs);
         break;
       }
     }
@@ -235,6 +439,10 @@ class NodePool extends EventEmitter {
         clearTimeout(this._handoffTimer);
         this._handoffTimer = null;
       }
+      if (this._handoffStartedAt !== null) {
+        metrics.handoffDuration.observe((performance.now() - this._handoffStartedAt) / 1000);
+        this._handoffStartedAt = null;
+      }
       this._poolLogger.info(`Node ${nodeId} promoted to active`);
       this.emit('active:changed', nodeId);
       return;
@@ -248,14 +456,65 @@ class NodePool extends EventEmitter {
     }
   }
 
+  /**
+   * Check the RSSI tracks and hand off to a standby node that has clearly
+   * and consistently beaten the active node.
+   */
+  _evaluateProactiveHandoff() {
+    if (!this._config.proactiveHandoff || this._handoffInProgress || !this._activeNodeId) return;
+
+    const targetId = this._rssiTracker.evaluate(this._activeNodeId, Date.now());
+    if (targetId && this._nodes.has(targetId)) {
+      this._switchActiveNode(targetId);
+    }
+  }
+
+  /**
+   * Move the BLE connection from the active node to another node.
+   * The target is promoted via _tryPromoteNode once it reports bleConnected;
+   * if it fails to do so within handoffTimeout, a scan-based handoff runs.
+   * @param {string} targetId
+   */
+  _switchActiveNode(targetId) {
+    const current = this.getActiveNode();
+    const now = Date.now();
+    this._poolLogger.info(`Proactive handoff from ${current.nodeId} to ${targetId}`, {
+      fromRssi: Math.round(this._rssiTracker.get(current.nodeId, now)),
+      toRssi: Math.round(this._rssiTracker.get(targetId, now)),
+    });
+
+    current.isActive = false;
+    this._activeNodeId = null;
+    this._handoffInProgress = true;
+    this._handoffStartedAt = performance.now();
+    proactiveHandoffs.inc();
+
+    // The collar accepts one connection: release it before the target connects
+    this._sendToNode(current.nodeId, MSG_DISCONNECT_BLE);
+    this._sendToNode(targetId, MSG_CONNECT);
+    this.emit('active:changed', null);
+
+    if (this._handoffTimer) clearTimeout(this._handoffTimer);
+    this._handoffTimer = setTimeout(() => {
+      this._handoffTimer = null;
+      if (!this._activeNodeId && this._nodes.size > 0) {
+        this._poolLogger.warn(`Node ${targetId} did not take over, falling back to scan handoff`);
+        this._handoffInProgress = false;
+        this.triggerHandoff();
+      }
+    }, this._config.handoffTimeout);
+  }
+
   /**
    * Trigger the handoff process when the active node loses BLE.
    *
    * Flow:
    * 1. Send scan to ALL nodes
-   * 2. Wait for scan_result from all (with timeout)
-   * 3. Pick node with best (strongest) RSSI
-   * 4. Send connect to elected node
+   * 2. Collect scan_sighting / scan_result messages as they stream in
+   * 3. Elect as soon as a sighting is strong enough (electionRssi), every
+   *    node has finished its scan, or every node has sighted the device and
+   *    electionSettle has passed. The full scan window is only a fallback.
+   * 4. Send scan_cancel to all nodes and connect to the elected node
    * 5. Wait for status { bleConnected: true }
    */
   triggerHandoff() {
@@ -267,7 +526,10 @@ class NodePool extends EventEmitter {
     }
 
     this._handoffInProgress = true;
-    this._pendingScanResults = new Map();
+    this._clearElection();
+    scanHandoffs.inc();
+    // Retries and fallbacks from a proactive handoff keep the original start
+    if (this._handoffStartedAt === null) this._handoffStartedAt = performance.now();
 
     this._poolLogger.info(`Starting handoff scan (${this._config.scanDuration / 1000}s) on ${this._nodes.size} node(s)`);
 
@@ -276,9 +538,16 @@ class NodePool extends EventEmitter {
       this._sendToNode(nodeId, MSG_SCAN, { duration: this._config.scanDuration });
     }
 
-    // Wait for scan results to arrive, then elect
+    // Elect early when the confidence rules allow, or after the full window
     const scanWaitTime = this._config.scanDuration + 3000; // extra 3s for network latency
-    setTimeout(() => this._electNode(), scanWaitTime);
+    this._election = {
+      nodes: new Set(this._nodes.keys()),
+      sightings: new DeviceTable({ ttl: 0 }), // nodeId -> RSSI samples of the device
+      finished: new Set(),
+      startedAt: Date.now(),
+      fallbackTimer: setTimeout(() => this._electNode('scan window elapsed'), scanWaitTime),
+      settleTimer: null,
+    };
 
     // Set handoff retry timer
     this._handoffTimer = setTimeout(() => {
@@ -291,28 +560,85 @@ class NodePool extends EventEmitter {
   }
 
   /**
-   * Elect the best node based on scan results and instruct it to connect.
+   * Record an RSSI sighting of the device by a node during an election.
+   * @param {string} nodeId
+   * @param {number} rssi - RSSI in dBm
    */
-  _electNode() {
-    if (!this._pendingScanResults) return;
+  _recordSighting(nodeId, rssi) {
+    if (typeof rssi !== 'number') return;
+    this._election.sightings.observe(nodeId, rssi);
+  }
+
+  /**
+   * Evaluate the early-election rules against the sightings so far.
+   */
+  _checkElection() {
+    const election = this._election;
+    if (!election) return;
+
+    for (const entry of election.sightings.entries()) {
+      const rssi = DeviceTable.rssiStats(entry).max;
+      if (rssi >= this._config.electionRssi) {
+        this._electNode(`strong signal (${rssi} dBm)`);
+        return;
+      }
+    }
+
+    let allFinished = true;
+    let allSighted = true;
+    for (const nodeId of election.nodes) {
+      if (!this._nodes.has(nodeId)) continue; // node disconnected during scan
+      if (!election.finished.has(nodeId)) allFinished = false;
+      if (!election.sightings.get(nodeId)) allSighted = false;
+    }
+
+    if (allFinished) {
+      this._electNode('all nodes finished scanning');
+    } else if (allSighted && !election.settleTimer) {
+      election.settleTimer = setTimeout(
+        () => this._electNode('all nodes sighted the device'),
+        this._config.electionSettle
+      );
+    }
+  }
+
+  /**
+   * Stop election timers and forget collected sightings.
+   */
+  _clearElection() {
+    if (!this._election) return;
+    clearTimeout(this._election.fallbackTimer);
+    clearTimeout(this._election.settleTimer);
+    this._election = null;
+  }
+
+  /**
+   * Elect the best node based on sightings and instruct it to connect.
+   * @param {string} reason - Which rule triggered the election (for logging)
+   */
+  _electNode(reason) {
+    const election = this._election;
+    if (!election) return;
 
     let bestNodeId = null;
     let bestRssi = -Infinity;
 
-    for (const [nodeId, devices] of this._pendingScanResults) {
+    for (const entry of election.sightings.entries()) {
+      const nodeId = entry.key;
       if (!this._nodes.has(nodeId)) continue; // node disconnected during scan
-
-      // Find the best RSSI among discovered devices for this node
-      for (const device of devices) {
-        const rssi = device.rssi;
-        if (typeof rssi === 'number' && rssi > bestRssi) {
-          bestRssi = rssi;
-          bestNodeId = nodeId;
-        }
+      const rssi = DeviceTable.rssiStats(entry).max;
+      if (rssi > bestRssi) {
+        bestRssi = rssi;
+        bestNodeId = nodeId;
       }
     }
 
-    this._pendingScanResults = null;
+    this._clearElection();
+
+    // Stop scans that are still running so the radio is free for connect
+    for (const nodeId of election.nodes) {
+      this._sendToNode(nodeId, MSG_SCAN_CANCEL);
+    }
 
     if (!bestNodeId) {
       this._poolLogger.warn('No node found the device during scan');
@@ -320,7 +646,8 @@ class NodePool extends EventEmitter {
       return;
     }
 
-    this._poolLogger.info(`Elected node ${bestNodeId} (RSSI: ${bestRssi} dBm), sending connect`);
+    const elapsed = Date.now() - election.startedAt;
+    this._poolLogger.info(`Elected node ${bestNodeId} (RSSI: ${bestRssi} dBm) after ${elapsed}ms: ${reason}, sending connect`);
     this._sendToNode(bestNodeId, MSG_CONNECT);
     // Node will report status { bleConnected: true } which triggers _tryPromoteNode
   }
@@ -341,38 +668,231 @@ class NodePool extends EventEmitter {
   getNodes() {
     return Array.from(this._nodes.values()).map(entry => ({
       nodeId: entry.nodeId,
+      capabilities: entry.capabilities,
       bleConnected: entry.bleConnected,
       lastBattery: entry.lastBattery,
       lastSeen: entry.lastSeen,
       isActive: entry.isActive,
+      rssi: entry.smoothedRssi !== null ? Math.round(entry.smoothedRssi) : null,
+      commandsInFlight: entry.inFlight.size,
+      commandsQueued: entry.sendQueue.length,
     }));
   }
 
+  /**
+   * Get command pipeline metrics for the active node.
+   * @returns {{ window: number, inFlight: number, queued: number, sent: number, acked: number, timeouts: number, dropped: number }}
+   */
+  getCommandStats() {
+    const active = this.getActiveNode();
+    return {
+      window: this._config.commandWindow,
+      inFlight: active ? active.inFlight.size : 0,
+      queued: active ? active.sendQueue.length : 0,
+      ...this._commandStats,
+    };
+  }
+
   /**
    * Send a BLE command via the active node.
+   *
+   * Up to `commandWindow` commands may be unacknowledged per node; further
+   * commands wait in a bounded queue and are sent as acks free the window.
    * @param {Buffer} data - Raw command data
-   * @returns {Promise<boolean>} True if command was sent successfully
+   * @param {Object} [options]
+   * @param {Object} [options.trace] - Latency trace to stamp
+   * @returns {Promise<string>} WriteResult once the node acknowledges, times out or the command is dropped
    */
-  async sendCommand(data) {
+  async sendCommand(data, options = {}) {
+    return this._submitCommand({ type: MSG_COMMAND, data, trace: options.trace || null });
+  }
+
+  /**
+   * Send a timed command sequence to the active node, which runs the steps
+   * locally and acknowledges once with the result of its first write.
+   * Only valid when supportsSequences() is true.
+   * @param {Array<{ buffer: Buffer, offset: number }>} steps - From planCommand()
+   * @param {Object} [options]
+   * @param {boolean} [options.coalesce=false] - Supersede earlier coalescing sequences
+   * @param {Object} [options.trace] - Latency trace to stamp
+   * @returns {Promise<string>} WriteResult of the first write
+   */
+  async sendSequence(steps, options = {}) {
+    return this._submitCommand({
+      type: MSG_SEQUENCE, steps, coalesce: !!options.coalesce, trace: options.trace || null,
+    });
+  }
+
+  /**
+   * Send control values to the active node, which builds the command with
+   * its own copy of the device module and runs the resulting sequence
+   * locally. One ack comes back for the whole command.
+   * Only valid when supportsCommandSpecs() is true.
+   * @param {Object} values - Control values (e.g., { shock: 50, vibro: 20, sound: 0 })
+   * @param {Object} [options]
+   * @param {boolean} [options.coalesce=false] - Supersede earlier coalescing commands
+   * @param {Object} [options.trace] - Latency trace to stamp
+   * @returns {Promise<string>} WriteResult of the first write
+   */
+  async sendCommandSpec(values, options = {}) {
+    return this._submitCommand({
+      type: MSG_COMMAND_SPEC, values, coalesce: !!options.coalesce, trace: options.trace || null,
+    });
+  }
+
+  /**
+   * Check whether the active node can run command sequences locally.
+   * @returns {boolean}
+   */
+  supportsSequences() {
+    const active = this.getActiveNode();
+    return !!active && active.capabilities.includes(CAP_SEQUENCE);
+  }
+
+  /**
+   * Check whether the active node can build commands from control values.
+   * @returns {boolean}
+   */
+  supportsCommandSpecs() {
+    const active = this.getActiveNode();
+    return !!active && active.capabilities.includes(CAP_COMMAND_SPEC);
+  }
+
+  /**
+   * Put a command or sequence into the active node's send window.
+   * A coalescing command replaces coalescing commands still queued.
+   * @param {Object} command - { type, data }, { type, steps, coalesce } or { type, values, coalesce }, plus trace
+   * @returns {Promise<string>} WriteResult
+   */
+  async _submitCommand(command) {
     const active = this.getActiveNode();
     if (!active) {
       this._poolLogger.warn('Cannot send command: no active node');
-      return false;
+      return WriteResult.FAILED;
     }
 
-    const id = ++this._commandCounter;
-    const hex = data.toString('hex');
+    if (command.coalesce) {
+      active.sendQueue = active.sendQueue.filter((queued) => {
+        if (!queued.coalesce) return true;
+        this._commandStats.dropped++;
+        queued.resolve(WriteResult.SUPERSEDED);
+        return false;
+      });
+    }
 
     return new Promise((resolve) => {
-      const timer = setTimeout(() => {
-        this._pendingCommands.delete(id);
-        this._poolLogger.warn(`Command ${id} timed out`);
-        resolve(false);
-      }, 5000);
+      command.resolve = resolve;
+      command.timer = null;
+
+      if (active.inFlight.size < this._config.commandWindow) {
+        this._transmitCommand(active, command);
+      } else if (active.sendQueue.length < this._config.commandQueueLimit) {
+        active.sendQueue.push(command);
+      } else {
+        this._commandStats.dropped++;
+        this._poolLogger.warn(`Command queue full for node ${active.nodeId}, dropping command`);
+        resolve(WriteResult.DROPPED);
+      }
+    });
+  }
 
-      this._pendingCommands.set(id, { resolve, timer });
-      this._sendToNode(active.nodeId, MSG_COMMAND, { id, data: hex });
+  /**
+   * Assign an id to a command, arm its timeout and send it to the node.
+   * JSON payloads carry the trace id so the node can log it; binary command
+   * frames are correlated by command id alone.
+   * @param {Object} entry - NodeEntry
+   * @param {Object} command - { type, data | steps | values, trace, resolve, timer }
+   */
+  _transmitCommand(entry, command) {
+    const id = ++this._commandCounter;
+    let payload;
+    if (command.type === MSG_COMMAND_SPEC) {
+      payload = { id, coalesce: command.coalesce, values: command.values };
+    } else if (command.type === MSG_SEQUENCE) {
+      payload = {
+        id,
+        coalesce: command.coalesce,
+        steps: command.steps.map(step => ({ data: step.buffer.toString('hex'), offset: step.offset })),
+      };
+    } else {
+      const { data } = command;
+      payload = entry.binary ? { id, data } : { id, data: data.toString('hex') };
+    }
+    if (command.trace && !(command.type === MSG_COMMAND && entry.binary)) {
+      payload.trace = command.trace.id;
+    }
+
+    command.timer = this._commandTimeouts.schedule(this._config.commandTimeout, () => {
+      if (!entry.inFlight.delete(id)) return;
+      this._commandStats.timeouts++;
+      metrics.commandTimeouts.inc();
+      this._poolLogger.warn(`Command ${id} timed out`);
+      command.resolve(WriteResult.FAILED);
+      this._pumpCommands(entry);
     });
+
+    entry.inFlight.set(id, command);
+    this._commandStats.sent++;
+    metrics.commandsSent.inc();
+    markTrace(command.trace, 'write');
+    this._sendToNode(entry.nodeId, command.type, payload);
+  }
+
+  /**
+   * Resolve all in-flight commands with ids in [from, to].
+   * @param {Object} entry - NodeEntry
+   * @param {number} from - First acknowledged id
+   * @param {number} to - Last acknowledged id
+   * @param {string} result - WriteResult reported by the node
+   * @param {number} [nodeUs] - Node processing time reported for command `to` (µs)
+   */
+  _ackCommands(entry, from, to, result, nodeUs) {
+    // Iterate the window rather than the range: it is bounded by commandWindow
+    for (const [id, command] of entry.inFlight) {
+      if (id < from || id > to) continue;
+      entry.inFlight.delete(id);
+      this._commandTimeouts.cancel(command.timer);
+      this._commandStats.acked++;
+      if (command.trace) {
+        markTrace(command.trace, 'acked');
+        if (id === to && nodeUs !== undefined) command.trace.nodeUs = nodeUs;
+      }
+      command.resolve(result);
+    }
+    this._pumpCommands(entry);
+  }
+
+  /**
+   * Move queued commands into the window as space frees up.
+   * Commands queued on a node that is no longer active fail immediately.
+   * @param {Object} entry - NodeEntry
+   */
+  _pumpCommands(entry) {
+    while (entry.sendQueue.length > 0 && entry.inFlight.size < this._config.commandWindow) {
+      const command = entry.sendQueue.shift();
+      if (!entry.isActive) {
+        command.resolve(WriteResult.FAILED);
+        continue;
+      }
+      this._transmitCommand(entry, command);
+    }
+  }
+
+  /**
+   * Fail all in-flight and queued commands for a node.
+   * @param {Object} entry - NodeEntry
+   */
+  _failCommands(entry) {
+    for (const command of entry.inFlight.values()) {
+      this._commandTimeouts.cancel(command.timer);
+      command.resolve(WriteResult.FAILED);
+    }
+    entry.inFlight.clear();
+
+    for (const command of entry.sendQueue) {
+      command.resolve(WriteResult.FAILED);
+    }
+    entry.sendQueue.length = 0;
   }
 
   /**
@@ -382,19 +902,7 @@ class NodePool extends EventEmitter {
   async requestBattery() {
     const active = this.getActiveNode();
     if (!active) return null;
-
-    return new Promise((resolve) => {
-      const handler = (level) => {
-        clearTimeout(timer);
-        resolve(level);
-      };
-      const timer = setTimeout(() => {
-        this.removeListener('battery', handler);
-        resolve(active.lastBattery);
-      }, 3000);
-      this.once('battery', handler);
-      this._sendToNode(active.nodeId, MSG_GET_BATTERY);
-    });
+    return this._requestTelemetry(active, MSG_GET_BATTERY, 'battery', active.lastBattery);
   }
 
   /**
@@ -404,23 +912,38 @@ class NodePool extends EventEmitter {
   async requestRssi() {
     const active = this.getActiveNode();
     if (!active) return null;
+    return this._requestTelemetry(active, MSG_GET_RSSI, 'rssi', null);
+  }
 
-    return new Promise((resolve) => {
+  /**
+   * Ask the active node for a value and wait for the event carrying the
+   * answer. Callers while a request is in flight share it rather than each
+   * sending a message and adding a listener.
+   * @returns {Promise<*>} The answer, or `fallback` after 3 s
+   */
+  _requestTelemetry(active, type, event, fallback) {
+    const pending = this._telemetryRequests.get(type);
+    if (pending) return pending;
+
+    const request = new Promise((resolve) => {
       const handler = (value) => {
         clearTimeout(timer);
         resolve(value);
       };
       const timer = setTimeout(() => {
-        this.removeListener('rssi', handler);
-        resolve(null);
+        this.removeListener(event, handler);
+        resolve(fallback);
       }, 3000);
-      this.once('rssi', handler);
-      this._sendToNode(active.nodeId, MSG_GET_RSSI);
-    });
+      this.once(event, handler);
+      this._sendToNode(active.nodeId, type);
+    }).finally(() => this._telemetryRequests.delete(type));
+    this._telemetryRequests.set(type, request);
+    return request;
   }
 
   /**
    * Send a message to a specific node.
+   * Uses a binary frame when the node negotiated it and the type has one.
    * @param {string} nodeId
    * @param {string} type - Message type
    * @param {Object} [payload={}]
@@ -430,7 +953,11 @@ class NodePool extends EventEmitter {
     if (!entry) return;
 
     try {
-      entry.ws.send(formatMessage(type, payload));
+      if (entry.binary && hasBinaryForm(type)) {
+        entry.ws.send(formatBinaryMessage(type, payload));
+      } else {
+        entry.ws.send(formatMessage(type, payload));
+      }
     } catch (err) {
       this._poolLogger.error(`Failed to send to node ${nodeId}`, { error: err.message });
     }
@@ -452,16 +979,13 @@ class NodePool extends EventEmitter {
       clearTimeout(this._handoffTimer);
       this._handoffTimer = null;
     }
+    this._clearElection();
 
     for (const [nodeId] of this._nodes) {
       this.removeNode(nodeId);
     }
 
-    for (const [id, pending] of this._pendingCommands) {
-      clearTimeout(pending.timer);
-      pending.resolve(false);
-    }
-    this._pendingCommands.clear();
+    this._commandTimeouts.destroy();
   }
 }
 
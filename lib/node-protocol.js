@@ -1,27 +1,62 @@
 /**
  * Node protocol constants and helpers for forwarder communication.
  *
- * Defines the raw WebSocket JSON protocol used between the central server
- * and forwarder nodes (Node.js or ESP32).
+ * Defines the raw WebSocket protocol used between the central server and
+ * forwarder nodes (Node.js or ESP32). All messages have a JSON text form;
+ * hot-path messages additionally have a compact binary form that is used
+ * once both sides have negotiated the "binary" capability during auth.
  */
 
+const { WriteResult } = require('./constants');
+
 // Node -> Server message types
 const MSG_AUTH = 'auth';
 const MSG_STATUS = 'status';
 const MSG_SCAN_RESULT = 'scan_result';
+const MSG_SCAN_SIGHTING = 'scan_sighting';
 const MSG_BATTERY = 'battery';
 const MSG_RSSI = 'rssi';
+const MSG_RSSI_SAMPLE = 'rssi_sample';
 const MSG_COMMAND_RESULT = 'command_result';
 
 // Server -> Node message types
 const MSG_AUTH_RESULT = 'auth_result';
 const MSG_COMMAND = 'command';
+const MSG_SEQUENCE = 'sequence';
+const MSG_COMMAND_SPEC = 'command_spec';
 const MSG_GET_BATTERY = 'get_battery';
 const MSG_GET_RSSI = 'get_rssi';
 const MSG_SCAN = 'scan';
+const MSG_SCAN_CANCEL = 'scan_cancel';
 const MSG_CONNECT = 'connect';
 const MSG_DISCONNECT_BLE = 'disconnect_ble';
 
+// Capabilities negotiated via auth / auth_result
+const CAP_BINARY = 'binary';
+const CAP_SEQUENCE = 'sequence';
+const CAP_COMMAND_SPEC = 'command_spec'; // only granted when both sides load the same device module
+const CAP_RESULT_CODE = 'result_code'; // command_result carries the WriteResult, not just success
+const SUPPORTED_CAPABILITIES = [CAP_BINARY, CAP_SEQUENCE, CAP_COMMAND_SPEC, CAP_RESULT_CODE];
+
+// Binary frame type bytes: [type][varint id][payload]
+const BINARY_TYPES = {
+  [MSG_COMMAND]: 0x01,
+  [MSG_COMMAND_RESULT]: 0x02,
+};
+const BINARY_TYPE_NAMES = {
+  0x01: MSG_COMMAND,
+  0x02: MSG_COMMAND_RESULT,
+};
+
+// command_result status byte; 0 and 1 are also what nodes without result_code send
+const RESULT_CODES = {
+  [WriteResult.FAILED]: 0,
+  [WriteResult.WRITTEN]: 1,
+  [WriteResult.SUPERSEDED]: 2,
+  [WriteResult.DROPPED]: 3,
+};
+const RESULT_NAMES = Object.fromEntries(Object.entries(RESULT_CODES).map(([name, code]) => [code, name]));
+
 /**
  * Parse a raw WebSocket message into a typed object.
  * @param {string} raw - Raw JSON string from WebSocket
@@ -49,24 +84,208 @@ function formatMessage(type, payload = {}) {
   return JSON.stringify({ type, ...payload });
 }
 
+/**
+ * Number of bytes needed to encode an unsigned integer as a LEB128 varint.
+ * @param {number} value
+ * @returns {number}
+ */
+function varintLength(value) {
+  let len = 1;
+  while (value >= 0x80) {
+    value = Math.floor(value / 128);
+    len++;
+  }
+  return len;
+}
+
+/**
+ * Write an unsigned LEB128 varint into a buffer.
+ * @param {Buffer} buf
+ * @param {number} offset
+ * @param {number} value
+ * @returns {number} Offset after the varint
+ */
+function writeVarint(buf, offset, value) {
+  while (value >= 0x80) {
+    buf[offset++] = (value % 128) | 0x80;
+    value = Math.floor(value / 128);
+  }
+  buf[offset++] = value;
+  return offset;
+}
+
+/**
+ * Read an unsigned LEB128 varint from a buffer.
+ * @param {Buffer} buf
+ * @param {number} offset
+ * @returns {{ value: number, offset: number } | null} Null if truncated
+ */
+function readVarint(buf, offset) {
+  let value = 0;
+  let scale = 1;
+  while (offset < buf.length) {
+    const byte = buf[offset++];
+    value += (byte & 0x7f) * scale;
+    if ((byte & 0x80) === 0) return { value, offset };
+    scale *= 128;
+    if (scale > Number.MAX_SAFE_INTEGER) return null;
+  }
+  return null;
+}
+
+/**
+ * Check whether a message type has a binary encoding.
+ * @param {string} type - Message type constant
+ * @returns {boolean}
+ */
+function hasBinaryForm(type) {
+  return BINARY_TYPES[type] !== undefined;
+}
+
+/**
+ * Format a message as a binary frame.
+ *
+ * command:        [0x01][varint id][raw BLE data]
+ * command_result: [0x02][varint id][status][varint from]?[varint nodeUs]?
+ *
+ * The status byte is 1 for success and 0 for failure. With the result_code
+ * capability, `result` is sent instead: 2 for superseded, 3 for dropped.
+ * The optional `from` of command_result acknowledges the range [from, id].
+ * The optional `nodeUs` is the node's processing time for command `id` in
+ * microseconds; when present, `from` is always written (equal to id for a
+ * single ack).
+ *
+ * @param {string} type - Message type constant (must have a binary form)
+ * @param {Object} payload - Message fields ({ id, data } or { id, success, result?, from?, nodeUs? })
+ * @returns {Buffer|null} Binary frame, or null if the type has no binary form
+ */
+function formatBinaryMessage(type, payload) {
+  const typeByte = BINARY_TYPES[type];
+  if (typeByte === undefined) return null;
+
+  const id = payload.id || 0;
+  const body = type === MSG_COMMAND ? payload.data : null;
+  const hasNodeUs = type === MSG_COMMAND_RESULT && payload.nodeUs !== undefined;
+  const hasFrom = type === MSG_COMMAND_RESULT &&
+    (hasNodeUs || (payload.from !== undefined && payload.from !== id));
+  const from = payload.from ?? id;
+  const bodyLength = type === MSG_COMMAND
+    ? body.length
+    : 1 + (hasFrom ? varintLength(from) : 0) + (hasNodeUs ? varintLength(payload.nodeUs) : 0);
+
+  const buf = Buffer.allocUnsafe(1 + varintLength(id) + bodyLength);
+  buf[0] = typeByte;
+  const offset = writeVarint(buf, 1, id);
+
+  if (type === MSG_COMMAND) {
+    body.copy(buf, offset);
+  } else {
+    buf[offset] = RESULT_CODES[payload.result] ?? (payload.success ? 1 : 0);
+    let next = offset + 1;
+    if (hasFrom) next = writeVarint(buf, next, from);
+    if (hasNodeUs) writeVarint(buf, next, payload.nodeUs);
+  }
+  return buf;
+}
+
+/**
+ * Parse a binary frame into a typed object.
+ * For command frames, `data` is a Buffer (JSON frames carry a hex string).
+ * @param {Buffer} raw - Binary frame from WebSocket
+ * @returns {{ type: string, id: number, [key: string]: any } | null} Parsed message or null if invalid
+ */
+function parseBinaryMessage(raw) {
+  if (!Buffer.isBuffer(raw) || raw.length < 2) return null;
+
+  const type = BINARY_TYPE_NAMES[raw[0]];
+  if (!type) return null;
+
+  const idField = readVarint(raw, 1);
+  if (!idField) return null;
+
+  if (type === MSG_COMMAND) {
+    return { type, id: idField.value, data: raw.subarray(idField.offset) };
+  }
+
+  if (idField.offset >= raw.length) return null;
+  const status = raw[idField.offset];
+  const msg = { type, id: idField.value, success: status === 1 };
+  if (status > 1 && RESULT_NAMES[status]) msg.result = RESULT_NAMES[status];
+
+  if (idField.offset + 1 < raw.length) {
+    const fromField = readVarint(raw, idField.offset + 1);
+    if (!fromField) return null;
+    msg.from = fromField.value;
+
+    if (fromField.offset < raw.length) {
+      const nodeUsField = readVarint(raw, fromField.offset);
+      if (!nodeUsField) return null;
+      msg.nodeUs = nodeUsField.value;
+    }
+  }
+  return msg;
+}
+
+/**
+ * Parse an incoming WebSocket message in either framing.
+ * @param {Buffer|string} raw - Raw message
+ * @param {boolean} isBinary - Whether the message arrived as a binary frame
+ * @returns {{ type: string, [key: string]: any } | null}
+ */
+function decodeFrame(raw, isBinary) {
+  return isBinary ? parseBinaryMessage(raw) : parseMessage(raw.toString());
+}
+
+/**
+ * Intersect a peer's advertised capabilities with the ones we support.
+ * @param {string[]} [requested] - Capabilities advertised by the peer
+ * @returns {string[]} Capabilities enabled for this connection
+ */
+function negotiateCapabilities(requested) {
+  if (!Array.isArray(requested)) return [];
+  return SUPPORTED_CAPABILITIES.filter(cap => requested.includes(cap));
+}
+
 module.exports = {
   // Node -> Server
   MSG_AUTH,
   MSG_STATUS,
   MSG_SCAN_RESULT,
+  MSG_SCAN_SIGHTING,
   MSG_BATTERY,
   MSG_RSSI,
+  MSG_RSSI_SAMPLE,
   MSG_COMMAND_RESULT,
 
   // Server -> Node
   MSG_AUTH_RESULT,
   MSG_COMMAND,
+  MSG_SEQUENCE,
+  MSG_COMMAND_SPEC,
   MSG_GET_BATTERY,
   MSG_GET_RSSI,
   MSG_SCAN,
+  MSG_SCAN_CANCEL,
   MSG_CONNECT,
   MSG_DISCONNECT_BLE,
 
+  // Capabilities
+  CAP_BINARY,
+  CAP_SEQUENCE,
+  CAP_COMMAND_SPEC,
+  CAP_RESULT_CODE,
+  SUPPORTED_CAPABILITIES,
+
   parseMessage,
   formatMessage,
+  parseBinaryMessage,
+  formatBinaryMessage,
+  hasBinaryForm,
+  decodeFrame,
+  negotiateCapabilities,
+
+  // Varint helpers (also used by the command journal)
+  varintLength,
+  writeVarint,
+  readVarint,
 };
@@ -0,0 +1,89 @@
+/**
+ * Adaptive reconnect scheduling.
+ *
+ * The first attempt after a loss runs immediately, later attempts back off
+ * exponentially with jitter up to a cap. While waiting, an attempt can be
+ * pulled forward with expedite(), e.g. when the device's advert is seen.
+ */
+
+class ReconnectScheduler {
+  /**
+   * @param {Object} options
+   * @param {number} [options.baseDelay=250] - Delay before the second attempt (ms)
+   * @param {number} [options.maxDelay=5000] - Upper bound on the delay (ms)
+   * @param {number} [options.jitter=0.3] - Random +/- fraction applied to each delay
+   * @param {Function} attempt - Called for each attempt
+   */
+  constructor(options, attempt) {
+    this._baseDelay = options.baseDelay || 250;
+    this._maxDelay = options.maxDelay || 5000;
+    this._jitter = options.jitter ?? 0.3;
+    this._attempt = attempt;
+    this._attempts = 0;
+    this._timer = null;
+  }
+
+  /**
+   * Schedule the next attempt. No-op if one is already pending.
+   * @returns {number} Delay in ms until the attempt
+   */
+  schedule() {
+    if (this._timer) return 0;
+
+    const delay = this._nextDelay();
+    this._attempts++;
+    this._timer = setTimeout(() => this._fire(), delay);
+    return delay;
+  }
+
+  /**
+   * Run the pending attempt now instead of waiting out the backoff.
+   * @returns {boolean} True if an attempt was pending
+   */
+  expedite() {
+    if (!this._timer) return false;
+    clearTimeout(this._timer);
+    this._fire();
+    return true;
+  }
+
+  /**
+   * Reset the backoff after a successful connection.
+   */
+  reset() {
+    this.cancel();
+    this._attempts = 0;
+  }
+
+  /**
+   * Cancel the pending attempt, if any.
+   */
+  cancel() {
+    if (this._timer) {
+      clearTimeout(this._timer);
+      this._timer = null;
+    }
+  }
+
+  /**
+   * Whether an attempt is waiting to run.
+   * @returns {boolean}
+   */
+  get pending() {
+    return !!this._timer;
+  }
+
+  _fire() {
+    this._timer = null;
+    this._attempt();
+  }
+
+  _nextDelay() {
+    if (this._attempts === 0) return 0;
+    const exponential = Math.min(this._maxDelay, this._baseDelay * 2 ** (this._attempts - 1));
+    const spread = exponential * this._jitter;
+    return Math.max(0, Math.round(exponential - spread + Math.random() * 2 * spread));
+  }
+}
+
+module.exports = { ReconnectScheduler };
@@ -0,0 +1,262 @@
+/**
+ * Shared scan scheduler, one per noble instance (adapter).
+ *
+ * noble has a single scan state per adapter: two callers that start and
+ * stop scanning independently stop each other mid-window. Every scan goes
+ * through this scheduler instead. Subscribers are reference counted; the
+ * radio scans while at least one is active, i.e. for the union of the
+ * requested windows, and stops as soon as the last one ends. Start and
+ * stop calls are serialized, and a scan stopped underneath us (e.g. by
+ * the platform on connect) is restarted while subscribers remain.
+ *
+ * One 'discover' listener fans adverts out to each subscriber whose filter
+ * accepts them. The radio reports each device once per scan unless a
+ * subscriber asks for duplicates (every advert, needed to follow RSSI and
+ * last-seen times); the scan is restarted in that mode while such a
+ * subscriber is active. Without duplicates a device already reported in the
+ * running scan would never reach a late subscriber, so the latest advert of
+ * every device seen so far is replayed to it.
+ */
+
+const { registry } = require('./metrics');
+const { DeviceTable } = require('./device-table');
+
+const metrics = {
+  radioStarts: registry.counter('scan_radio_starts_total', 'Times the radio started scanning'),
+  radioActive: registry.gauge('scan_radio_active', 'Whether the radio is scanning (1) or not (0)'),
+  subscribers: registry.gauge('scan_subscribers', 'Active scan subscribers'),
+};
+
+const schedulers = new WeakMap(); // noble -> ScanScheduler
+
+class ScanScheduler {
+  /**
+   * @param {Object} noble - noble (or SimulatedNoble) instance
+   * @param {Object} logger - Logger instance
+   */
+  constructor(noble, logger) {
+    this._noble = noble;
+    this._logger = logger.child('scan-scheduler');
+
+    this._subscribers = new Set();
+    this._seen = new DeviceTable(); // address -> latest peripheral (entry.info) in the running scan
+    this._scanning = false;
+    this._duplicates = false; // mode of the running scan
+    this._busy = false; // a start or stop call is in flight
+    this._nextId = 1;
+
+    this._noble.on('discover', peripheral => this._onDiscover(peripheral));
+    this._noble.on('scanStop', () => this._onScanStop());
+  }
+
+  /**
+   * Subscribe to adverts, starting the radio if needed.
+   * @param {Object} options
+   * @param {Function} options.onDiscover - (peripheral) => void
+   * @param {Function} [options.filter] - (peripheral) => boolean; all adverts when omitted
+   * @param {number} [options.duration] - End the subscription after this long (ms); until stopped when omitted
+   * @param {AbortSignal} [options.signal] - Ends the subscription
+   * @param {string} [options.name='scan'] - Shown in debug logs
+   * @param {boolean} [options.duplicates=false] - Receive every advert, not just the first per device
+   * @returns {{ ready: Promise<void>, done: Promise<string>, stop: Function }} `ready` settles when
+   *   the radio is scanning (rejects if it could not start); `done` resolves with 'complete',
+   *   'stopped' or 'error' when the subscription ends
+   */
+  subscribe(options) {
+    const subscriber = {
+      id: this._nextId++,
+      name: options.name || 'scan',
+      onDiscover: options.onDiscover,
+      filter: options.filter || null,
+      duplicates: !!options.duplicates,
+      signal: options.signal || null,
+      timer: null,
+      onAbort: null,
+      resolveReady: null,
+      rejectReady: null,
+      resolveDone: null,
+    };
+    const ready = new Promise((resolve, reject) => {
+      subscriber.resolveReady = resolve;
+      subscriber.rejectReady = reject;
+    });
+    ready.catch(() => {}); // callers that only await `done` need not handle it
+    const done = new Promise((resolve) => {
+      subscriber.resolveDone = resolve;
+    });
+    const handle = { ready, done, stop: () => this._end(subscriber, 'stopped') };
+
+    if (subscriber.signal?.aborted) {
+      this._settle(subscriber, 'stopped');
+      return handle;
+    }
+    if (options.duration) {
+      subscriber.timer = setTimeout(() => this._end(subscriber, 'complete'), options.duration);
+    }
+    if (subscriber.signal) {
+      subscriber.onAbort = () => this._end(subscriber, 'stopped');
+      subscriber.signal.addEventListener('abort', subscriber.onAbort);
+    }
+
+    this._subscribers.add(subscriber);
+    metrics.subscribers.set(this._subscribers.size);
+    this._logger.debug('Subscribed', { id: subscriber.id, name: subscriber.name, subscribers: this._subscribers.size });
+
+    if (this._scanning && !this._busy && (this._duplicates || !subscriber.duplicates)) {
+      subscriber.resolveReady();
+      // Devices the running scan already reported will not be reported again
+      if (this._seen.size > 0) {
+        const seen = this._seen.entries().map(entry => entry.info);
+        setImmediate(() => {
+          for (const peripheral of seen) {
+            if (!this._subscribers.has(subscriber)) return;
+            this._deliver(subscriber, peripheral);
+          }
+        });
+      }
+    }
+    this._reconcile();
+    return handle;
+  }
+
+  /**
+   * Whether the radio is scanning.
+   * @returns {boolean}
+   */
+  isScanning() {
+    return this._scanning;
+  }
+
+  /**
+   * Number of active subscribers.
+   * @returns {number}
+   */
+  getSubscriberCount() {
+    return this._subscribers.size;
+  }
+
+  _onDiscover(peripheral) {
+    // Adverts can arrive before startScanningAsync() resolves
+    if (!this._scanning && !this._busy) return;
+    if (peripheral.address) this._seen.observe(peripheral.address, peripheral.rssi).info = peripheral;
+    // Snapshot: subscribers may end themselves from their callback
+    for (const subscriber of Array.from(this._subscribers)) {
+      this._deliver(subscriber, peripheral);
+    }
+  }
+
+  _deliver(subscriber, peripheral) {
+    try {
+      if (subscriber.filter && !subscriber.filter(peripheral)) return;
+      subscriber.onDiscover(peripheral);
+    } catch (err) {
+      this._logger.error('Scan subscriber failed', { id: subscriber.id, name: subscriber.name, error: err.message });
+    }
+  }
+
+  _onScanStop() {
+    if (this._busy || !this._scanning) return;
+    // Stopped by the platform or another noble user, not by us
+    this._logger.debug('Scan stopped externally', { subscribers: this._subscribers.size });
+    this._setScanning(false);
+    this._reconcile();
+  }
+
+  _end(subscriber, reason) {
+    if (!this._subscribers.delete(subscriber)) return;
+    metrics.subscribers.set(this._subscribers.size);
+    this._logger.debug('Unsubscribed', { id: subscriber.id, name: subscriber.name, reason, subscribers: this._subscribers.size });
+    this._settle(subscriber, reason);
+    this._reconcile();
+  }
+
+  _settle(subscriber, reason, error) {
+    clearTimeout(subscriber.timer);
+    if (subscriber.onAbort) subscriber.signal.removeEventListener('abort', subscriber.onAbort);
+    // Ended before the radio started: nobody should wait on `ready` forever
+    if (error) subscriber.rejectReady(error);
+    else subscriber.resolveReady();
+    subscriber.resolveDone(reason);
+  }
+
+  _setScanning(scanning) {
+    this._scanning = scanning;
+    if (!scanning) this._seen.clear();
+    metrics.radioActive.set(scanning ? 1 : 0);
+  }
+
+  /**
+   * Bring the radio in line with the subscriber count, one call at a time.
+   */
+  _reconcile() {
+    if (this._busy) return;
+    const wanted = this._subscribers.size > 0;
+    const duplicates = this._wantsDuplicates();
+    if (wanted === this._scanning && (!wanted || duplicates === this._duplicates)) return;
+
+    this._busy = true;
+    // A running scan in the wrong mode is restarted in place
+    const operation = wanted ? this._start(duplicates) : this._stop();
+    operation.finally(() => {
+      this._busy = false;
+      this._reconcile();
+    });
+  }
+
+  _wantsDuplicates() {
+    for (const subscriber of this._subscribers) {
+      if (subscriber.duplicates) return true;
+    }
+    return false;
+  }
+
+  async _start(duplicates) {
+    const restart = this._scanning;
+    try {
+      await this._noble.waitForPoweredOnAsync();
+      await this._noble.startScanningAsync([], duplicates);
+    } catch (err) {
+      // Everyone waiting for this start fails with it; later subscribers retry
+      this._logger.error('Failed to start scanning', { error: err.message });
+      for (const subscriber of Array.from(this._subscribers)) {
+        this._subscribers.delete(subscriber);
+        this._settle(subscriber, 'error', err);
+      }
+      metrics.subscribers.set(0);
+      return;
+    }
+
+    this._duplicates = duplicates;
+    this._setScanning(true);
+    if (!restart) metrics.radioStarts.inc();
+    this._logger.debug('Radio scanning', { subscribers: this._subscribers.size, duplicates });
+    for (const subscriber of this._subscribers) subscriber.resolveReady();
+  }
+
+  async _stop() {
+    try {
+      await this._noble.stopScanningAsync();
+    } catch (err) {
+      this._logger.debug('Stop scanning error (non-fatal)', { error: err.message });
+    }
+    this._setScanning(false);
+    this._logger.debug('Radio idle');
+  }
+}
+
+/**
+ * The scan scheduler of a noble instance, created on first use.
+ * @param {Object} noble
+ * @param {Object} logger - Used when the scheduler is created
+ * @returns {ScanScheduler}
+ */
+function scanSchedulerFor(noble, logger) {
+  let scheduler = schedulers.get(noble);
+  if (!scheduler) {
+    scheduler = new ScanScheduler(noble, logger);
+    schedulers.set(noble, scheduler);
+  }
+  return scheduler;
+}
+
+module.exports = { ScanScheduler, scanSchedulerFor };
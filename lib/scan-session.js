@@ -0,0 +1,219 @@
+/**
+ * Shared, streaming scan sessions.
+ *
+ * Viewers (Socket.io clients, SSE streams, /api/scan requests) join a
+ * session with their own window and filter. All viewers share one radio
+ * scan, which runs until the last viewer's window ends or every viewer
+ * has cancelled. A viewer that joins a running session first gets the
+ * devices already seen, then live updates.
+ *
+ * Devices are kept in one DeviceTable per session, shared by the radio
+ * scans it runs, so a long session stays bounded and its RSSI statistics
+ * span restarts. New devices and RSSI changes are collected and delivered
+ * in batches every updateInterval, so a busy environment does not turn
+ * every advert into a message. RSSI changes can only be streamed if the
+ * scan reports repeat adverts: scanForDevices() scans with duplicates for
+ * this reason.
+ *
+ * Viewer callback events:
+ *   'devices'  Array of new or changed devices (latest RSSI)
+ *   'end'      { reason: 'complete'|'cancelled'|'error', devices, error? }
+ *              with the viewer's final device list
+ */
+
+const { EventEmitter } = require('events');
+const { DeviceTable } = require('./device-table');
+
+// A scan that ends this much before its window without being stopped failed
+const EARLY_END_TOLERANCE = 50;
+// Shorter remainders are left to the viewers' own timers
+const MIN_SCAN_WINDOW = 250;
+
+class ScanSessionManager extends EventEmitter {
+  /**
+   * @param {Object} config
+   * @param {number} [config.updateInterval=250] - Batching interval for device updates (ms)
+   * @param {number} [config.maxDuration=300000] - Longest window a viewer can ask for (ms)
+   * @param {number} [config.maxDevices=1000] - Devices kept per session; the least recently seen are evicted
+   * @param {number} [config.deviceTtl=60000] - Drop devices not seen for this long (ms)
+   * @param {Function} scan - (duration, { showAll, onDevice, signal, table }) => Promise<Array>, e.g. BleDevice.scan;
+   *   onDevice must be called again when a device's RSSI changes
+   * @param {Object} logger - Logger instance
+   */
+  constructor(config, scan, logger) {
+    super();
+    this._config = {
+      updateInterval: config.updateInterval || 250,
+      maxDuration: config.maxDuration || 300000,
+      maxDevices: config.maxDevices || 1000,
+      deviceTtl: config.deviceTtl || 60000,
+    };
+    this._scan = scan;
+    this._logger = logger.child('scan-session');
+
+    this._viewers = new Set();
+    this._nextViewerId = 1;
+    this._session = null;
+  }
+
+  /**
+   * Join the shared scan, starting it if needed.
+   * @param {Object} options
+   * @param {number} [options.duration=10000] - How long this viewer wants results (ms)
+   * @param {boolean} [options.showAll=false] - Include devices that are not compatible
+   * @param {Function} onEvent - (event, data) => void, see module docs
+   * @returns {{ id: number, cancel: Function }}
+   */
+  join(options, onEvent) {
+    const duration = Math.max(1000, Math.min(options.duration || 10000, this._config.maxDuration));
+    const viewer = {
+      id: this._nextViewerId++,
+      showAll: !!options.showAll,
+      until: Date.now() + duration,
+      onEvent,
+      timer: null,
+    };
+    viewer.timer = setTimeout(() => this._endViewer(viewer, 'complete'), duration);
+    this._viewers.add(viewer);
+
+    if (!this._session) {
+      this._startSession();
+    } else {
+      const known = this._filter(viewer, this._session.devices.list());
+      if (known.length > 0) this._deliver(viewer, 'devices', known);
+      // A later window than the running radio scan covers: restarted when it ends
+    }
+    this._logger.debug('Viewer joined', { viewer: viewer.id, duration, showAll: viewer.showAll, viewers: this._viewers.size });
+
+    return {
+      id: viewer.id,
+      cancel: () => this._endViewer(viewer, 'cancelled'),
+    };
+  }
+
+  /**
+   * Whether a shared scan is running.
+   * @returns {boolean}
+   */
+  isScanning() {
+    return this._session !== null;
+  }
+
+  /**
+   * End all viewers and stop the radio scan.
+   */
+  destroy() {
+    for (const viewer of Array.from(this._viewers)) this._endViewer(viewer, 'cancelled');
+  }
+
+  _startSession() {
+    const session = {
+      devices: new DeviceTable({ capacity: this._config.maxDevices, ttl: this._config.deviceTtl }),
+      pending: new Map(), // address -> device changed since the last batch
+      flushTimer: null,
+      abort: null,
+      scans: 0,
+    };
+    this._session = session;
+    this._logger.info('Shared scan started');
+    this.emit('started');
+    this._runScan(session);
+  }
+
+  async _runScan(session) {
+    // The session closes when its last viewer ends
+    const duration = Math.max(0, ...Array.from(this._viewers, viewer => viewer.until)) - Date.now();
+    if (duration < MIN_SCAN_WINDOW) return;
+
+    const abort = new AbortController();
+    session.abort = abort;
+    session.scans++;
+    const startedAt = Date.now();
+    let error = null;
+    try {
+      await this._scan(duration, {
+        showAll: true,
+        quiet: session.scans > 1,
+        signal: abort.signal,
+        table: session.devices,
+        onDevice: device => this._onDevice(session, device),
+      });
+    } catch (err) {
+      error = err;
+    }
+    if (this._session !== session || abort.signal.aborted) return;
+
+    if (error || Date.now() - startedAt < duration - EARLY_END_TOLERANCE) {
+      // Adapter off or the scan could not start: no point retrying for every viewer
+      const message = error ? error.message : 'Scan ended early';
+      this._logger.warn('Shared scan failed', { error: message });
+      for (const viewer of Array.from(this._viewers)) this._endViewer(viewer, 'error', message);
+      return;
+    }
+
+    // A viewer that joined later still wants results: keep the radio going
+    this._runScan(session);
+  }
+
+  _onDevice(session, device) {
+    session.pending.set(device.address, device);
+    if (!session.flushTimer) {
+      session.flushTimer = setTimeout(() => this._flush(session), this._config.updateInterval);
+    }
+  }
+
+  _flush(session) {
+    clearTimeout(session.flushTimer);
+    session.flushTimer = null;
+    if (session.pending.size === 0) return;
+
+    const changed = Array.from(session.pending.values());
+    session.pending.clear();
+    for (const viewer of this._viewers) {
+      const devices = this._filter(viewer, changed);
+      if (devices.length > 0) this._deliver(viewer, 'devices', devices);
+    }
+  }
+
+  _filter(viewer, devices) {
+    const result = [];
+    for (const device of devices) {
+      if (viewer.showAll || device.isCompatible) result.push(device);
+    }
+    return result;
+  }
+
+  _deliver(viewer, event, data) {
+    try {
+      viewer.onEvent(event, data);
+    } catch (err) {
+      this._logger.error('Scan viewer callback failed', { viewer: viewer.id, error: err.message });
+    }
+  }
+
+  _endViewer(viewer, reason, error) {
+    if (!this._viewers.has(viewer)) return;
+    const session = this._session;
+    // Deliver what is still batched before the final list
+    if (session) this._flush(session);
+
+    clearTimeout(viewer.timer);
+    this._viewers.delete(viewer);
+    const devices = session ? this._filter(viewer, session.devices.list()) : [];
+    this._deliver(viewer, 'end', error ? { reason, devices, error } : { reason, devices });
+    this._logger.debug('Viewer left', { viewer: viewer.id, reason, viewers: this._viewers.size });
+
+    if (session && this._viewers.size === 0) this._closeSession(session);
+  }
+
+  _closeSession(session) {
+    if (this._session !== session) return;
+    this._session = null;
+    clearTimeout(session.flushTimer);
+    if (session.abort) session.abort.abort();
+    this._logger.info('Shared scan stopped', { devices: session.devices.size, scans: session.scans });
+    this.emit('stopped');
+  }
+}
+
+module.exports = { ScanSessionManager };
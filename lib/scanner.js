@@ -2,6 +2,17 @@
  * BLE device scanner for finding compatible devices.
  */
 
+const { registry } = require('./metrics');
+const { scanSchedulerFor } = require('./scan-scheduler');
+const { AdvertMatcher, MATCH_SERVICE, MATCH_NAME, MATCH_NONE } = require('./advert-matcher');
+const { DeviceTable } = require('./device-table');
+
+const metrics = {
+  scans: registry.counter('scan_runs_total', 'BLE scans started'),
+  advertReports: registry.counter('scan_advert_reports_total', 'Advertisement reports received while scanning'),
+  uniqueDevices: registry.gauge('scan_unique_devices', 'Devices included in the most recent completed scan'),
+};
+
 /**
  * Scan for nearby BLE devices and log those with the matching service or name.
  * @param {Noble} noble - The noble instance
@@ -11,17 +22,28 @@
  * @param {string|null} serviceUuid - Service UUID in noble format (lowercase no-dash) to match
  * @param {Object} [options] - Additional options
  * @param {boolean} [options.showAll=false] - Return all discovered devices, not just compatible ones
- * @returns {Promise<Array>} Array of discovered compatible devices
+ * @param {Function} [options.onDevice] - Called with each included device when first seen or when its RSSI or name changes
+ * @param {AbortSignal} [options.signal] - Ends the scan early; resolves with the devices found so far
+ * @param {boolean} [options.quiet=false] - Log scan start/finish and matches at debug level (background scans)
+ * @param {AdvertMatcher} [options.matcher] - Prebuilt matcher for namePatterns/serviceUuid, reused across scans
+ * @param {DeviceTable} [options.table] - Table to record sightings in, e.g. one shared by consecutive scans
+ * @param {number} [options.maxDevices=1000] - Capacity of the scan's own table when none is given
+ * @param {number} [options.deviceTtl=60000] - Drop devices not seen for this long (ms) from the scan's own table
+ * @returns {Promise<Array>} Devices in the table when the scan ends, with RSSI statistics (see DeviceTable.snapshot)
  */
 function scanForDevices(noble, logger, duration = 10000, namePatterns = [], serviceUuid = null, options = {}) {
-  const { showAll = false } = options;
+  const { showAll = false, onDevice = null, signal = null, quiet = false } = options;
+  const devices = options.table || new DeviceTable({ capacity: options.maxDevices, ttl: options.deviceTtl });
+  const matcher = options.matcher ||
+    new AdvertMatcher({ serviceUuids: serviceUuid ? [serviceUuid] : [], namePatterns });
 
   return new Promise(async (resolve) => {
-    const devices = new Map();
     let totalReports = 0;
     const scanLogger = logger.child('scanner');
+    const logLevel = quiet ? 'debug' : 'info';
+    const debugEnabled = scanLogger.isLevelEnabled('debug');
 
-    scanLogger.info(`Starting BLE scan for ${duration / 1000} seconds...${showAll ? ' (showing all devices)' : ''}`);
+    scanLogger[logLevel](`Starting BLE scan for ${duration / 1000} seconds...${showAll ? ' (showing all devices)' : ''}`);
     scanLogger.debug('Detection config', {
       serviceUuid: serviceUuid || '(none)',
       namePatterns,
@@ -39,84 +61,86 @@ function scanForDevices(noble, logger, duration = 10000, namePatterns = [], serv
 
     const onDiscover = (peripheral) => {
       totalReports += 1;
+      metrics.advertReports.inc();
       const address = peripheral.address;
       const addressType = peripheral.addressType;
       const rssi = peripheral.rssi;
       const name = peripheral.advertisement?.localName || 'Unknown';
 
-      // Noble provides service UUIDs in lowercase no-dash format
-      const serviceUuids = peripheral.advertisement?.serviceUuids || [];
-      const hasMatchingService = serviceUuid ? serviceUuids.includes(serviceUuid) : false;
-
-      const matchesNamePattern = namePatterns.length > 0 &&
-        namePatterns.some(pattern => name.toLowerCase().includes(pattern.toLowerCase()));
-
-      const isCompatible = hasMatchingService || matchesNamePattern;
-      const detectionMethod = hasMatchingService ? 'service-uuid' : (matchesNamePattern ? 'name-pattern' : 'none');
+      // Compiled once, cached per address: repeat reports skip matching
+      const detectionMethod = matcher.match(peripheral);
+      const isCompatible = detectionMethod !== MATCH_NONE;
 
-      scanLogger.debug('Advert report', {
-        address,
-        addressType,
-        name,
-        rssi,
-        serviceUuids,
-        hasMatchingService,
-        matchesNamePattern,
-        isCompatible,
-        detectionMethod,
-      });
-
-      const shouldInclude = showAll || isCompatible;
-
-      if (shouldInclude && !devices.has(address)) {
-        devices.set(address, {
+      // Runs for every advert: only build the record when debug is on
+      if (debugEnabled) {
+        scanLogger.debug('Advert report', {
           address,
           addressType,
           name,
           rssi,
-          timestamp: new Date().toISOString(),
-          detectionMethod,
+          serviceUuids: peripheral.advertisement?.serviceUuids || [],
+          hasMatchingService: detectionMethod === MATCH_SERVICE,
+          matchesNamePattern: detectionMethod === MATCH_NAME,
           isCompatible,
+          detectionMethod,
         });
+      }
+
+      if (!showAll && !isCompatible) return;
 
+      const now = Date.now();
+      const previousRssi = devices.get(address, now)?.rssi;
+      const entry = devices.observe(address, rssi, now);
+      const info = entry.info;
+
+      if (info === null) {
+        entry.info = { address, addressType, name, detectionMethod, isCompatible };
         if (isCompatible) {
-          scanLogger.info(`Found compatible device: ${name}`, {
+          scanLogger[logLevel](`Found compatible device: ${name}`, {
             address,
             addressType,
             rssi: `${rssi} dBm`,
             detectionMethod,
           });
         }
+        if (onDevice) onDevice(devices.snapshot(entry));
+      } else if (info.name !== name || info.detectionMethod !== detectionMethod) {
+        // The name often arrives later, in the scan response
+        info.name = name;
+        info.detectionMethod = detectionMethod;
+        info.isCompatible = isCompatible;
+        if (onDevice) onDevice(devices.snapshot(entry));
+      } else if (onDevice && previousRssi !== entry.rssi) {
+        onDevice(devices.snapshot(entry));
       }
     };
 
-    noble.on('discover', onDiscover);
+    // Shares the radio with any other scan on this adapter. Every advert is
+    // needed: it advances last-seen (the table's TTL) and adds RSSI samples.
+    metrics.scans.inc();
+    const subscription = scanSchedulerFor(noble, logger).subscribe({
+      name: quiet ? 'background scan' : 'scan',
+      duplicates: true,
+      duration,
+      signal,
+      onDiscover,
+    });
 
-    try {
-      await noble.startScanningAsync([], false);
-    } catch (err) {
-      scanLogger.error('Failed to start scanning', { error: err.message });
-      noble.removeListener('discover', onDiscover);
+    const reason = await subscription.done;
+    if (reason === 'error') {
+      // The scheduler has logged why the radio could not start
       resolve([]);
       return;
     }
 
-    setTimeout(async () => {
-      try {
-        await noble.stopScanningAsync();
-      } catch (err) {
-        scanLogger.debug('Stop scanning error (non-fatal)', { error: err.message });
-      }
-      noble.removeListener('discover', onDiscover);
-
-      const deviceList = Array.from(devices.values());
-      scanLogger.info(`Scan complete. Found ${deviceList.length} device(s)${showAll ? ' (all)' : ' (compatible)'}`);
-      scanLogger.debug('Scan summary', {
-        totalReports,
-        uniqueDevices: deviceList.length,
-      });
-      resolve(deviceList);
-    }, duration);
+    const deviceList = devices.list();
+    metrics.uniqueDevices.set(deviceList.length);
+    scanLogger[logLevel](`Scan complete. Found ${deviceList.length} device(s)${showAll ? ' (all)' : ' (compatible)'}`);
+    scanLogger.debug('Scan summary', {
+      totalReports,
+      uniqueDevices: deviceList.length,
+    });
+    resolve(deviceList);
   });
 }
 
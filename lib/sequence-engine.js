@@ -0,0 +1,199 @@
+/**
+ * Timed command sequence engine.
+ *
+ * Device modules describe what a command looks like over time in the
+ * result of buildCommand():
+ *
+ *   { buffer }                                       single write
+ *   { buffer, repeat: true, repeatDelay: 300 }       write, then once more after 300 ms
+ *   { buffer, hold: { duration: 2000, interval: 250 } }  rewrite every 250 ms for 2 s
+ *   { steps: [{ buffer, offset: 0 }, { buffer, offset: 300 }] }  explicit timeline
+ *
+ * planCommand() turns any of these into a step list. A SequenceEngine runs
+ * any number of step lists for one device off a single timer. Each step is
+ * scheduled at an absolute offset from its sequence's start on the
+ * monotonic clock, so lateness never accumulates, and its jitter is recorded.
+ */
+
+const { performance } = require('perf_hooks');
+
+/**
+ * Normalize a buildCommand() result into timed steps.
+ * @param {Object} result - buildCommand() result
+ * @returns {Array<{ buffer: Buffer, offset: number }>} Steps sorted by offset
+ */
+function planCommand(result) {
+  if (!result) return [];
+
+  if (Array.isArray(result.steps)) {
+    return result.steps
+      .filter(step => step && step.buffer)
+      .map(step => ({ buffer: step.buffer, offset: Math.max(0, step.offset || 0) }))
+      .sort((a, b) => a.offset - b.offset);
+  }
+
+  if (!result.buffer) return [];
+
+  if (result.hold && result.hold.interval > 0) {
+    const steps = [];
+    for (let offset = 0; offset <= (result.hold.duration || 0); offset += result.hold.interval) {
+      steps.push({ buffer: result.buffer, offset });
+    }
+    return steps;
+  }
+
+  const steps = [{ buffer: result.buffer, offset: 0 }];
+  if (result.repeat && result.repeatDelay) {
+    steps.push({ buffer: result.buffer, offset: result.repeatDelay });
+  }
+  return steps;
+}
+
+class SequenceEngine {
+  /**
+   * @param {Function} onStep - (step, sequence) => void, called when a step is due
+   */
+  constructor(onStep) {
+    this._onStep = onStep;
+    this._sequences = new Set();
+    this._timer = null;
+    this._timerDue = Infinity;
+    this._nextId = 0;
+    this._jitter = { last: 0, max: 0, total: 0, samples: 0 };
+  }
+
+  /**
+   * Start a sequence. Steps with offset 0 run synchronously.
+   * @param {Array<{ buffer: Buffer, offset: number }>} steps - From planCommand()
+   * @param {Object} [meta] - Extra fields copied onto the sequence (e.g. coalesce)
+   * @returns {Object} Sequence handle ({ id, steps, next, startedAt, ...meta })
+   */
+  start(steps, meta = {}) {
+    const sequence = {
+      ...meta,
+      id: ++this._nextId,
+      steps,
+      next: 0,
+      startedAt: performance.now(),
+    };
+
+    this._sequences.add(sequence);
+    this._runDue();
+    return sequence;
+  }
+
+  /**
+   * Cancel a sequence's remaining steps.
+   * @param {Object} sequence - Handle from start()
+   * @returns {number} Number of steps that will no longer run
+   */
+  cancel(sequence) {
+    if (!this._sequences.delete(sequence)) return 0;
+    const remaining = sequence.steps.length - sequence.next;
+    sequence.next = sequence.steps.length;
+    this._arm();
+    return remaining;
+  }
+
+  /**
+   * Cancel every sequence matching a predicate.
+   * @param {Function} predicate - (sequence) => boolean
+   * @returns {number} Number of steps that will no longer run
+   */
+  cancelWhere(predicate) {
+    let cancelled = 0;
+    for (const sequence of this._sequences) {
+      if (predicate(sequence)) cancelled += this.cancel(sequence);
+    }
+    return cancelled;
+  }
+
+  /**
+   * Cancel all sequences.
+   */
+  cancelAll() {
+    this.cancelWhere(() => true);
+  }
+
+  /**
+   * Number of sequences with steps still to run.
+   * @returns {number}
+   */
+  get active() {
+    return this._sequences.size;
+  }
+
+  /**
+   * Step timing statistics.
+   * @returns {{ active: number, steps: number, jitterMs: { last: number, max: number, mean: number } }}
+   */
+  getStats() {
+    const { last, max, total, samples } = this._jitter;
+    return {
+      active: this._sequences.size,
+      steps: samples,
+      jitterMs: {
+        last: Math.round(last * 100) / 100,
+        max: Math.round(max * 100) / 100,
+        mean: samples ? Math.round((total / samples) * 100) / 100 : 0,
+      },
+    };
+  }
+
+  /**
+   * Run every step that is due, then re-arm the timer for the next one.
+   */
+  _runDue() {
+    const now = performance.now();
+
+    for (const sequence of this._sequences) {
+      while (sequence.next < sequence.steps.length) {
+        const step = sequence.steps[sequence.next];
+        const due = sequence.startedAt + step.offset;
+        if (due > now) break;
+
+        sequence.next++;
+        if (step.offset > 0) this._recordJitter(now - due);
+        this._onStep(step, sequence);
+      }
+      if (sequence.next >= sequence.steps.length) {
+        this._sequences.delete(sequence);
+      }
+    }
+
+    this._arm();
+  }
+
+  /**
+   * Point the single timer at the earliest pending step.
+   */
+  _arm() {
+    let nextDue = Infinity;
+    for (const sequence of this._sequences) {
+      const step = sequence.steps[sequence.next];
+      if (step) nextDue = Math.min(nextDue, sequence.startedAt + step.offset);
+    }
+
+    if (nextDue === this._timerDue) return;
+    if (this._timer) clearTimeout(this._timer);
+    this._timer = null;
+    this._timerDue = nextDue;
+
+    if (nextDue !== Infinity) {
+      this._timer = setTimeout(() => {
+        this._timer = null;
+        this._timerDue = Infinity;
+        this._runDue();
+      }, Math.max(0, nextDue - performance.now()));
+    }
+  }
+
+  _recordJitter(ms) {
+    this._jitter.last = ms;
+    this._jitter.max = Math.max(this._jitter.max, ms);
+    this._jitter.total += ms;
+    this._jitter.samples++;
+  }
+}
+
+module.exports = { SequenceEngine, planCommand };
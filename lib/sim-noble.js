@@ -0,0 +1,446 @@
+/**
+ * Simulated noble adapter for running without Bluetooth hardware.
+ *
+ * Implements the subset of the @stoprocent/noble API used by BleDevice, the
+ * scanner and the forwarder, backed by scripted peripherals instead of a
+ * radio. Select it with `ble.binding: "simulator"` and describe the virtual
+ * environment in `ble.simulator` (an object or a path to a JSON file):
+ *
+ *   {
+ *     "seed": 1,                      PRNG seed for noise and jitter
+ *     "peripherals": [{
+ *       "address": "c0:de:00:00:00:01",
+ *       "name": "btt_xg_sim",
+ *       "serviceUuids": ["6e400001b5a3f393e0a9e50e24dcca9e"],  default: device module service
+ *       "advertInterval": 100,        ms between adverts
+ *       "rssi": -55,                  or "rssiTrace": [[0, -50], [5000, -85], [8000, null]]
+ *       "rssiNoise": 2,               +/- dBm added to every reading
+ *       "connectionInterval": 30,     ms, paces writes, responses and GATT procedures
+ *       "connectLatency": 90,         ms until a connection is established
+ *       "writeBuffer": 6,             write-without-response packets buffered before loss
+ *       "packetsPerEvent": 4,         packets sent per connection event
+ *       "failConnects": 0,            number of initial connection attempts that fail
+ *       "disconnectAfter": [5000],    drop the Nth connection after this many ms
+ *       "advertisesWhenConnected": false,
+ *       "responses": [{ "match": "ddaabb", "reply": "aa0700001e5a0000bb" }]
+ *     }]
+ *   }
+ *
+ * Times in an RSSI trace are ms since the simulator was created; values are
+ * interpolated linearly, and null means out of range (no adverts, and an
+ * open connection is dropped). All randomness comes from the seeded PRNG, so
+ * a scenario replays the same way on every run.
+ */
+
+const fs = require('fs');
+const path = require('path');
+const EventEmitter = require('events');
+const { performance } = require('perf_hooks');
+
+const LINK_CHECK_INTERVAL = 200;
+
+/**
+ * Small seeded PRNG (mulberry32).
+ * @param {number} seed
+ * @returns {Function} () => number in [0, 1)
+ */
+function createRandom(seed) {
+  let state = seed >>> 0;
+  return () => {
+    state = (state + 0x6D2B79F5) >>> 0;
+    let t = state;
+    t = Math.imul(t ^ (t >>> 15), t | 1);
+    t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+    return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+  };
+}
+
+function delay(ms) {
+  return new Promise(resolve => setTimeout(resolve, ms));
+}
+
+function normalizeUuid(uuid) {
+  return String(uuid).replace(/-/g, '').toLowerCase();
+}
+
+class SimulatedCharacteristic extends EventEmitter {
+  constructor(peripheral, uuid, properties) {
+    super();
+    this.uuid = uuid;
+    this.properties = properties;
+    this._peripheral = peripheral;
+    this._generation = peripheral._gattGeneration;
+  }
+
+  async writeAsync(data, withoutResponse) {
+    this._checkUsable();
+    return this._peripheral._queuePacket(Buffer.from(data), withoutResponse);
+  }
+
+  async subscribeAsync() {
+    this._checkUsable();
+    await delay(this._peripheral._ci);
+    this._peripheral._subscribed = this;
+  }
+
+  async unsubscribeAsync() {
+    if (this._peripheral._subscribed === this) this._peripheral._subscribed = null;
+  }
+
+  _checkUsable() {
+    if (this._peripheral.state !== 'connected') {
+      throw new Error('Peripheral not connected');
+    }
+    if (this._generation !== this._peripheral._gattGeneration) {
+      throw new Error('Invalid handle');
+    }
+  }
+}
+
+class SimulatedPeripheral extends EventEmitter {
+  constructor(adapter, spec) {
+    super();
+    this._adapter = adapter;
+    this._spec = spec;
+
+    this.address = spec.address.toLowerCase();
+    this.id = this.address.replace(/:/g, '');
+    this.uuid = this.id;
+    this.addressType = spec.addressType || 'public';
+    this.connectable = spec.connectable !== false;
+    this.advertisement = {
+      localName: spec.name,
+      serviceUuids: spec.serviceUuids.map(normalizeUuid),
+      manufacturerData: null,
+      txPowerLevel: null,
+    };
+    this.rssi = 127;
+    this.state = 'disconnected';
+    this.mtu = null;
+
+    this._ci = spec.connectionInterval ?? 30;
+    this._gattGeneration = 0;
+    this._characteristics = null;
+    this._subscribed = null;
+    this._queue = []; // { data, submittedAt, ack }
+    this._eventTimer = null;
+    this._linkTimer = null;
+    this._dropTimer = null;
+    this._failConnects = spec.failConnects || 0;
+    this._connections = 0;
+
+    this.stats = { connects: 0, failedConnects: 0, disconnects: 0, writes: 0, delivered: 0, dropped: 0 };
+  }
+
+  /**
+   * Current RSSI from the scripted value or trace, with noise.
+   * @returns {number|null} dBm, or null when out of range
+   */
+  currentRssi() {
+    let rssi = this._spec.rssi ?? -60;
+    const trace = this._spec.rssiTrace;
+    if (Array.isArray(trace) && trace.length > 0) {
+      const t = this._adapter.now();
+      let i = 0;
+      while (i < trace.length - 1 && trace[i + 1][0] <= t) i++;
+      const [t0, r0] = trace[i];
+      const next = trace[i + 1];
+      if (r0 === null) return null;
+      rssi = r0;
+      if (next && next[1] !== null && t > t0) {
+        rssi = r0 + ((next[1] - r0) * (t - t0)) / (next[0] - t0);
+      }
+    }
+    if (rssi === null) return null;
+    const noise = this._spec.rssiNoise || 0;
+    return Math.round(rssi + (this._adapter._random() * 2 - 1) * noise);
+  }
+
+  async connectAsync() {
+    if (this.state === 'connected') return;
+    this.state = 'connecting';
+
+    const latency = (this._spec.connectLatency ?? 3 * this._ci) + this._adapter._random() * this._ci;
+    await delay(latency);
+
+    if (this.currentRssi() === null || !this.connectable) {
+      this.state = 'disconnected';
+      this.stats.failedConnects++;
+      throw new Error('Connection timed out');
+    }
+    if (this._failConnects > 0) {
+      this._failConnects--;
+      this.state = 'disconnected';
+      this.stats.failedConnects++;
+      throw new Error('Connection failed to be established');
+    }
+
+    this.state = 'connected';
+    this.stats.connects++;
+    this._startLinkWatch(this._connections++);
+  }
+
+  async disconnectAsync() {
+    if (this.state !== 'connected') return;
+    await delay(this._ci);
+    this._drop('local');
+  }
+
+  async updateRssiAsync() {
+    if (this.state !== 'connected') throw new Error('Peripheral not connected');
+    await delay(this._ci);
+    const rssi = this.currentRssi();
+    if (rssi !== null) this.rssi = rssi;
+    return this.rssi;
+  }
+
+  async discoverSomeServicesAndCharacteristicsAsync(serviceUuids, characteristicUuids) {
+    if (this.state !== 'connected') throw new Error('Peripheral not connected');
+    // Discovery takes a few round trips
+    await delay((this._spec.discoveryEvents ?? 4) * this._ci);
+
+    if (!this._characteristics || this._characteristics[0]._generation !== this._gattGeneration) {
+      this._characteristics = [
+        new SimulatedCharacteristic(this, this._spec.tx, ['write', 'writeWithoutResponse']),
+        new SimulatedCharacteristic(this, this._spec.rx, ['notify']),
+      ];
+    }
+
+    const wanted = (characteristicUuids || []).map(normalizeUuid);
+    const characteristics = wanted.length > 0
+      ? this._characteristics.filter(char => wanted.includes(char.uuid))
+      : this._characteristics.slice();
+    return { services: [{ uuid: this._spec.service }], characteristics };
+  }
+
+  /**
+   * Invalidate discovered GATT handles (as after a firmware update), so the
+   * next operation on an old characteristic fails.
+   */
+  invalidateGatt() {
+    this._gattGeneration++;
+  }
+
+  _queuePacket(data, withoutResponse) {
+    this.stats.writes++;
+    const submittedAt = performance.now();
+
+    if (withoutResponse) {
+      if (this._queue.length >= (this._spec.writeBuffer ?? 6)) {
+        this.stats.dropped++; // controller buffer full, nothing reports it
+      } else {
+        this._queue.push({ data, submittedAt, ack: null });
+        this._armEvents();
+      }
+      return Promise.resolve();
+    }
+
+    return new Promise((resolve, reject) => {
+      this._queue.push({ data, submittedAt, ack: { resolve, reject } });
+      this._armEvents();
+    });
+  }
+
+  _armEvents() {
+    if (this._eventTimer) return;
+    this._eventTimer = setInterval(() => this._connectionEvent(), this._ci);
+  }
+
+  _connectionEvent() {
+    const now = performance.now();
+    for (const packet of this._queue.splice(0, this._spec.packetsPerEvent ?? 4)) {
+      this.stats.delivered++;
+      this.emit('packet', packet.data, now - packet.submittedAt);
+      // The ATT response arrives on the next event
+      if (packet.ack) setImmediate(packet.ack.resolve);
+      this._respond(packet.data);
+    }
+    if (this._queue.length === 0) {
+      clearInterval(this._eventTimer);
+      this._eventTimer = null;
+    }
+  }
+
+  _respond(data) {
+    const hex = data.toString('hex');
+    for (const { match, reply } of this._spec.responses || []) {
+      if (hex.startsWith(String(match).toLowerCase())) {
+        setTimeout(() => {
+          if (this.state === 'connected' && this._subscribed) {
+            this._subscribed.emit('data', Buffer.from(reply, 'hex'), true);
+          }
+        }, this._ci);
+        return;
+      }
+    }
+  }
+
+  _startLinkWatch(connectionIndex) {
+    const disconnectAfter = this._spec.disconnectAfter || [];
+    if (disconnectAfter[connectionIndex] !== undefined && disconnectAfter[connectionIndex] !== null) {
+      this._dropTimer = setTimeout(() => this._drop('injected'), disconnectAfter[connectionIndex]);
+    }
+    this._linkTimer = setInterval(() => {
+      if (this.currentRssi() === null) this._drop('out of range');
+    }, LINK_CHECK_INTERVAL);
+  }
+
+  /**
+   * Tear down the connection and emit 'disconnect'.
+   * @param {string} reason
+   */
+  _drop(reason) {
+    if (this.state !== 'connected') return;
+    this.state = 'disconnected';
+    this.stats.disconnects++;
+    clearInterval(this._linkTimer);
+    clearTimeout(this._dropTimer);
+    clearInterval(this._eventTimer);
+    this._linkTimer = this._dropTimer = this._eventTimer = null;
+    this._subscribed = null;
+
+    for (const packet of this._queue) {
+      if (packet.ack) packet.ack.reject(new Error('Peripheral disconnected'));
+    }
+    this._queue = [];
+    setImmediate(() => this.emit('disconnect', reason));
+  }
+}
+
+class SimulatedNoble extends EventEmitter {
+  /**
+   * @param {Object|string} [scenario] - Scenario object or path to a JSON file
+   * @param {Object} [deviceModule] - Device module supplying default UUIDs and name
+   */
+  constructor(scenario = {}, deviceModule = null) {
+    super();
+    if (typeof scenario === 'string') {
+      scenario = JSON.parse(fs.readFileSync(path.resolve(scenario), 'utf8'));
+    }
+
+    this.state = 'poweredOn';
+    this._startedAt = performance.now();
+    this._random = createRandom(scenario.seed ?? 1);
+    this._scanning = false;
+    this._allowDuplicates = false;
+    this._serviceFilter = [];
+    this._seen = new Set();
+    this._advertTimers = new Map();
+
+    const uuids = deviceModule?._nobleUuids || {};
+    const specs = scenario.peripherals || [{ address: 'c0:de:00:00:00:01' }];
+    this._peripherals = new Map();
+    specs.forEach((spec, index) => {
+      const peripheral = new SimulatedPeripheral(this, {
+        name: `${deviceModule?.name || 'sim'}_${index + 1}`,
+        serviceUuids: uuids.service ? [uuids.service] : [],
+        service: uuids.service,
+        tx: uuids.tx,
+        rx: uuids.rx,
+        ...spec,
+      });
+      this._peripherals.set(peripheral.address, peripheral);
+    });
+  }
+
+  /**
+   * Milliseconds since the simulator was created (the RSSI trace clock).
+   * @returns {number}
+   */
+  now() {
+    return performance.now() - this._startedAt;
+  }
+
+  async waitForPoweredOnAsync() {}
+
+  async startScanningAsync(serviceUuids = [], allowDuplicates = false) {
+    this._serviceFilter = (serviceUuids || []).map(normalizeUuid);
+    this._allowDuplicates = allowDuplicates;
+    this._seen.clear();
+    if (this._scanning) return;
+
+    this._scanning = true;
+    this.emit('scanStart');
+    for (const peripheral of this._peripherals.values()) {
+      this._scheduleAdvert(peripheral, true);
+    }
+  }
+
+  async stopScanningAsync() {
+    if (!this._scanning) return;
+    this._scanning = false;
+    for (const timer of this._advertTimers.values()) clearTimeout(timer);
+    this._advertTimers.clear();
+    this.emit('scanStop');
+  }
+
+  /**
+   * Connect by address (the Linux HCI path).
+   * @param {string} address
+   * @returns {Promise<SimulatedPeripheral>}
+   */
+  async connectAsync(address) {
+    const peripheral = this.getPeripheral(address);
+    if (!peripheral) {
+      await delay(2000);
+      throw new Error('Connection timed out');
+    }
+    await peripheral.connectAsync();
+    return peripheral;
+  }
+
+  /**
+   * Look up a scripted peripheral.
+   * @param {string} address
+   * @returns {SimulatedPeripheral|undefined}
+   */
+  getPeripheral(address) {
+    return this._peripherals.get(String(address).toLowerCase());
+  }
+
+  /**
+   * Drop a peripheral's connection now.
+   * @param {string} address
+   */
+  injectDisconnect(address) {
+    this.getPeripheral(address)?._drop('injected');
+  }
+
+  stop() {
+    this.stopScanningAsync();
+    for (const peripheral of this._peripherals.values()) peripheral._drop('adapter stopped');
+  }
+
+  _scheduleAdvert(peripheral, firstAdvert = false) {
+    // Advertising events are spaced by the interval plus a 0-10 ms random
+    // delay; a scan starts at a random point in the advertiser's cycle
+    const advertInterval = peripheral._spec.advertInterval ?? 100;
+    const interval = firstAdvert
+      ? this._random() * advertInterval
+      : advertInterval + this._random() * 10;
+    this._advertTimers.set(peripheral.address, setTimeout(() => {
+      if (!this._scanning) return;
+      this._advertise(peripheral);
+      this._scheduleAdvert(peripheral);
+    }, interval));
+  }
+
+  _advertise(peripheral) {
+    if (peripheral.state === 'connected' && !peripheral._spec.advertisesWhenConnected) return;
+
+    const rssi = peripheral.currentRssi();
+    if (rssi === null) return;
+
+    if (this._serviceFilter.length > 0 &&
+        !peripheral.advertisement.serviceUuids.some(uuid => this._serviceFilter.includes(uuid))) {
+      return;
+    }
+    if (!this._allowDuplicates && this._seen.has(peripheral.address)) return;
+
+    this._seen.add(peripheral.address);
+    peripheral.rssi = rssi;
+    this.emit('discover', peripheral);
+  }
+}
+
+module.exports = { SimulatedNoble, createRandom };
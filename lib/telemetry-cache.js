@@ -0,0 +1,157 @@
+/**
+ * Telemetry cache with stale-while-revalidate and single-flight reads.
+ *
+ * Each channel (battery, RSSI, ...) has a fetch function that costs a radio
+ * transaction or a node round trip. Readers get the cached value while it
+ * is younger than `maxAge`. An older value, up to `maxStale`, is still
+ * returned at once while one background fetch refreshes it; only readers
+ * with nothing usable wait for a fetch. Concurrent fetches of a channel are
+ * merged into one, so any number of clients costs at most one transaction
+ * per channel per `maxAge`.
+ *
+ * Values pushed by the device (e.g. a battery notification) are stored with
+ * set(), and invalidate() drops a channel's value when its source changes,
+ * e.g. on a handoff between the local adapter and a node. Fetches started
+ * before an invalidate() are discarded when they complete.
+ */
+
+const { EventEmitter } = require('events');
+const { registry } = require('./metrics');
+
+const reads = registry.counter('telemetry_reads_total', 'Telemetry reads by cache result', {
+  labelNames: ['channel', 'result'],
+});
+const fetches = registry.counter('telemetry_fetches_total', 'Telemetry fetches from the device or a node', {
+  labelNames: ['channel'],
+});
+
+class TelemetryCache extends EventEmitter {
+  /**
+   * @param {Object} logger - Logger instance
+   */
+  constructor(logger) {
+    super();
+    this._logger = logger.child('telemetry');
+    this._channels = new Map(); // name -> channel
+  }
+
+  /**
+   * Add a channel.
+   * @param {string} name
+   * @param {Object} options
+   * @param {Function} options.fetch - () => Promise<value|null>; null means no value was obtained
+   * @param {number} options.maxAge - Values younger than this are served without a fetch (ms)
+   * @param {number} [options.maxStale=maxAge] - Values up to this old are served while a fetch runs (ms)
+   * @returns {TelemetryCache}
+   */
+  define(name, options) {
+    this._channels.set(name, {
+      name,
+      fetch: options.fetch,
+      maxAge: options.maxAge,
+      maxStale: Math.max(options.maxStale || 0, options.maxAge),
+      value: null,
+      updatedAt: 0,
+      inflight: null,
+      generation: 0, // bumped by invalidate()
+      series: {
+        fresh: reads.labels(name, 'fresh'),
+        stale: reads.labels(name, 'stale'),
+        miss: reads.labels(name, 'miss'),
+        fetches: fetches.labels(name),
+      },
+    });
+    return this;
+  }
+
+  /**
+   * Read a channel, fetching only when the cached value is too old.
+   * @param {string} name
+   * @returns {Promise<*>} The value, or null if none could be obtained
+   */
+  async get(name) {
+    const channel = this._channel(name);
+    const age = Date.now() - channel.updatedAt;
+    if (channel.value !== null && age <= channel.maxAge) {
+      channel.series.fresh.inc();
+      return channel.value;
+    }
+    if (channel.value !== null && age <= channel.maxStale) {
+      channel.series.stale.inc();
+      this._refresh(channel);
+      return channel.value;
+    }
+    channel.series.miss.inc();
+    return this._refresh(channel);
+  }
+
+  /**
+   * The cached value without fetching, however old.
+   * @param {string} name
+   * @returns {*} The value, or null
+   */
+  peek(name) {
+    return this._channel(name).value;
+  }
+
+  /**
+   * Store a value that arrived without a fetch. Emits 'update' if it changed.
+   * @param {string} name
+   * @param {*} value
+   */
+  set(name, value) {
+    const channel = this._channel(name);
+    const previous = channel.value;
+    channel.value = value;
+    channel.updatedAt = Date.now();
+    if (value !== previous) this.emit('update', name, value);
+  }
+
+  /**
+   * Drop a channel's value, e.g. when the link it came from went away.
+   * A fetch in flight is abandoned: its result is not stored, and the next
+   * read starts a new fetch against the current source.
+   * @param {string} name
+   */
+  invalidate(name) {
+    const channel = this._channel(name);
+    channel.value = null;
+    channel.updatedAt = 0;
+    channel.generation++;
+    channel.inflight = null;
+  }
+
+  _channel(name) {
+    const channel = this._channels.get(name);
+    if (!channel) throw new Error(`Unknown telemetry channel: ${name}`);
+    return channel;
+  }
+
+  /**
+   * Fetch a channel, joining a fetch already in flight.
+   * @returns {Promise<*>} The fetched value, or the cached one if the fetch got none or was abandoned
+   */
+  _refresh(channel) {
+    if (channel.inflight) return channel.inflight;
+    channel.series.fetches.inc();
+    const generation = channel.generation;
+    const inflight = (async () => {
+      try {
+        const value = await channel.fetch();
+        if (channel.generation !== generation) return channel.value; // source changed meanwhile
+        if (value === null || value === undefined) return channel.value;
+        this.set(channel.name, value);
+        return value;
+      } catch (err) {
+        this._logger.warn('Telemetry fetch failed', { channel: channel.name, error: err.message });
+        return channel.value;
+      } finally {
+        if (channel.inflight === inflight) channel.inflight = null;
+      }
+    })();
+    channel.inflight = inflight;
+    return inflight;
+  }
+}
+
+module.exports = { TelemetryCache };
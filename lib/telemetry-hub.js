@@ -0,0 +1,250 @@
+/**
+ * Push-based telemetry subscriptions.
+ *
+ * Clients subscribe to channels (battery, RSSI, link state, ...) with the
+ * highest update rate they want, as a minimum interval in ms. A sampled
+ * channel is read on one timer at the fastest rate any subscriber asked
+ * for, never faster than the channel's floor, and not at all without
+ * subscribers. Event-driven channels are read when refresh() is called.
+ * Either way a value is pushed only when it differs from the last one,
+ * and to each subscriber no more often than its interval: a change inside
+ * the interval is sent when the interval ends, as the latest value.
+ *
+ * Radio and Socket.io traffic therefore depend on the channels and rates
+ * in use, not on the number of viewers.
+ */
+
+const { registry } = require('./metrics');
+
+const pushes = registry.counter('telemetry_pushes_total', 'Telemetry values pushed to subscribers', {
+  labelNames: ['channel'],
+});
+const samples = registry.counter('telemetry_samples_total', 'Telemetry channel reads', {
+  labelNames: ['channel'],
+});
+const subscriberGauge = registry.gauge('telemetry_subscribers', 'Telemetry subscribers', {
+  labelNames: ['channel'],
+});
+
+class TelemetryHub {
+  /**
+   * @param {Object} logger - Logger instance
+   */
+  constructor(logger) {
+    this._logger = logger.child('telemetry-hub');
+    this._channels = new Map(); // name -> channel
+  }
+
+  /**
+   * Add a channel.
+   * @param {string} name - Also the event name values are pushed under
+   * @param {Object} options
+   * @param {Function} options.read - () => value or Promise<value>; null/undefined means no value
+   * @param {boolean} [options.sample=false] - Read periodically while subscribed, else only on refresh()
+   * @param {number} [options.minInterval=0] - Fastest sampling interval (ms)
+   * @param {number} [options.defaultInterval=0] - Subscriber interval when none is given (ms)
+   * @returns {TelemetryHub}
+   */
+  define(name, options) {
+    this._channels.set(name, {
+      name,
+      read: options.read,
+      sample: !!options.sample,
+      minInterval: options.minInterval || 0,
+      defaultInterval: options.defaultInterval || 0,
+      value: null,
+      key: null, // serialized value, for change detection
+      subscribers: new Map(), // client -> subscriber
+      reading: null,
+      sampleTimer: null,
+      sampleInterval: 0,
+      series: {
+        pushes: pushes.labels(name),
+        samples: samples.labels(name),
+        subscribers: subscriberGauge.labels(name),
+      },
+    });
+    return this;
+  }
+
+  /**
+   * Subscribe a client to channels, replacing its interval on channels it
+   * already has. Known values are sent right away.
+   * @param {*} client - Any key identifying the client, e.g. its socket
+   * @param {Object<string, number|null>} requests - Channel name -> min interval between pushes (ms); null for the default
+   * @param {Function} send - (channel, value) => void
+   * @returns {Object<string, number>} The channels subscribed, with their effective interval
+   */
+  subscribe(client, requests, send) {
+    const accepted = {};
+    for (const [name, requested] of Object.entries(requests || {})) {
+      const channel = this._channels.get(name);
+      if (!channel) continue;
+      const interval = Number.isFinite(requested) && requested >= 0 ? requested : channel.defaultInterval;
+
+      let subscriber = channel.subscribers.get(client);
+      if (subscriber) {
+        subscriber.interval = interval;
+      } else {
+        subscriber = { send, interval, sentKey: null, sentAt: 0, timer: null };
+        channel.subscribers.set(client, subscriber);
+        channel.series.subscribers.set(channel.subscribers.size);
+      }
+      accepted[name] = interval;
+
+      if (channel.value !== null) this._deliver(channel, subscriber);
+      else this.refresh(name);
+      this._reschedule(channel);
+    }
+    return accepted;
+  }
+
+  /**
+   * Unsubscribe a client.
+   * @param {*} client
+   * @param {Array<string>} [names] - Channels to leave; all when omitted
+   */
+  unsubscribe(client, names) {
+    for (const name of names || this._channels.keys()) {
+      const channel = this._channels.get(name);
+      const subscriber = channel?.subscribers.get(client);
+      if (!subscriber) continue;
+      clearTimeout(subscriber.timer);
+      channel.subscribers.delete(client);
+      channel.series.subscribers.set(channel.subscribers.size);
+      this._reschedule(channel);
+    }
+  }
+
+  /**
+   * Store a value that arrived from elsewhere and push it if it changed.
+   * @param {string} name
+   * @param {*} value
+   */
+  publish(name, value) {
+    const channel = this._channels.get(name);
+    if (!channel || value === null || value === undefined) return;
+    const key = JSON.stringify(value);
+    if (key === channel.key) return;
+    channel.value = value;
+    channel.key = key;
+    for (const subscriber of channel.subscribers.values()) this._deliver(channel, subscriber);
+  }
+
+  /**
+   * Forget a channel's value, e.g. when the link it came from went away,
+   * and push null to subscribers at once so they stop showing it. Later
+   * subscribers get a fresh read instead of the old value.
+   * @param {string} name
+   */
+  clear(name) {
+    const channel = this._channels.get(name);
+    if (!channel || channel.value === null) return;
+    channel.value = null;
+    channel.key = null;
+    for (const subscriber of channel.subscribers.values()) {
+      clearTimeout(subscriber.timer);
+      subscriber.timer = null;
+      subscriber.sentKey = null;
+      this._send(channel, subscriber, null);
+    }
+  }
+
+  /**
+   * Read a channel now and push the value if it changed. A read already
+   * in flight is joined rather than repeated.
+   * @param {string} name
+   * @returns {Promise<void>}
+   */
+  refresh(name) {
+    const channel = this._channels.get(name);
+    if (!channel) return Promise.resolve();
+    if (channel.reading) return channel.reading;
+    channel.series.samples.inc();
+    channel.reading = (async () => {
+      try {
+        this.publish(name, await channel.read());
+      } catch (err) {
+        this._logger.warn('Telemetry read failed', { channel: name, error: err.message });
+      } finally {
+        channel.reading = null;
+      }
+    })();
+    return channel.reading;
+  }
+
+  /**
+   * Subscriber counts and sampling intervals per channel.
+   * @returns {Object<string, { subscribers: number, sampleInterval: number|null }>}
+   */
+  getStats() {
+    const stats = {};
+    for (const channel of this._channels.values()) {
+      stats[channel.name] = {
+        subscribers: channel.subscribers.size,
+        sampleInterval: channel.sampleTimer ? channel.sampleInterval : null,
+      };
+    }
+    return stats;
+  }
+
+  /**
+   * Stop all timers.
+   */
+  close() {
+    for (const channel of this._channels.values()) {
+      for (const subscriber of channel.subscribers.values()) clearTimeout(subscriber.timer);
+      channel.subscribers.clear();
+      channel.series.subscribers.set(0);
+      this._reschedule(channel);
+    }
+  }
+
+  /**
+   * Send the channel's value to a subscriber, now or when its interval ends.
+   */
+  _deliver(channel, subscriber) {
+    if (subscriber.timer || subscriber.sentKey === channel.key) return;
+    const wait = subscriber.sentAt + subscriber.interval - Date.now();
+    if (wait > 0) {
+      subscriber.timer = setTimeout(() => {
+        subscriber.timer = null;
+        this._deliver(channel, subscriber);
+      }, wait);
+      return;
+    }
+    subscriber.sentKey = channel.key;
+    subscriber.sentAt = Date.now();
+    this._send(channel, subscriber, channel.value);
+  }
+
+  _send(channel, subscriber, value) {
+    channel.series.pushes.inc();
+    try {
+      subscriber.send(channel.name, value);
+    } catch (err) {
+      this._logger.error('Telemetry push failed', { channel: channel.name, error: err.message });
+    }
+  }
+
+  /**
+   * Sample at the fastest subscribed rate, or stop sampling without subscribers.
+   */
+  _reschedule(channel) {
+    if (!channel.sample) return;
+    let interval = Infinity;
+    for (const subscriber of channel.subscribers.values()) interval = Math.min(interval, subscriber.interval);
+    interval = interval === Infinity ? 0 : Math.max(interval, channel.minInterval, 1);
+    if (interval === channel.sampleInterval && (channel.sampleTimer !== null) === (interval > 0)) return;
+
+    clearInterval(channel.sampleTimer);
+    channel.sampleTimer = null;
+    channel.sampleInterval = interval;
+    if (interval > 0) {
+      channel.sampleTimer = setInterval(() => this.refresh(channel.name), interval);
+      channel.sampleTimer.unref?.();
+    }
+  }
+}
+
+module.exports = { TelemetryHub };
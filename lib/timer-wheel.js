@@ -0,0 +1,107 @@
+/**
+ * Hashed timer wheel for large numbers of coarse timeouts.
+ *
+ * All timeouts share a single interval timer that only runs while at least
+ * one timeout is scheduled. Callbacks run up to one tick late, never early,
+ * so this is meant for deadlines (command timeouts), not precise scheduling.
+ */
+
+class TimerWheel {
+  /**
+   * @param {Object} [options]
+   * @param {number} [options.tickMs=100] - Wheel resolution in ms
+   * @param {number} [options.slots=64] - Number of slots per rotation
+   */
+  constructor(options = {}) {
+    this._tickMs = options.tickMs || 100;
+    this._slots = Array.from({ length: options.slots || 64 }, () => new Set());
+    this._cursor = 0;
+    this._size = 0;
+    this._interval = null;
+  }
+
+  /**
+   * Schedule a callback after at least `delayMs`.
+   * @param {number} delayMs - Delay in ms
+   * @param {Function} callback - Called on expiry
+   * @returns {Object} Handle for cancel()
+   */
+  schedule(delayMs, callback) {
+    // A running wheel is somewhere inside the current tick: its next tick
+    // can come at any moment, so it does not count towards the delay
+    const ticks = Math.max(1, Math.ceil(delayMs / this._tickMs)) + (this._interval ? 1 : 0);
+    const slot = (this._cursor + ticks) % this._slots.length;
+    const handle = {
+      callback,
+      slot,
+      rounds: Math.floor((ticks - 1) / this._slots.length),
+    };
+
+    this._slots[slot].add(handle);
+    this._size++;
+    this._start();
+    return handle;
+  }
+
+  /**
+   * Cancel a scheduled callback. Safe to call more than once.
+   * @param {Object} handle - Handle returned by schedule()
+   */
+  cancel(handle) {
+    if (handle && this._slots[handle.slot].delete(handle)) {
+      this._size--;
+      if (this._size === 0) this._stop();
+    }
+  }
+
+  /**
+   * Number of scheduled callbacks.
+   * @returns {number}
+   */
+  get size() {
+    return this._size;
+  }
+
+  _start() {
+    if (this._interval) return;
+    this._interval = setInterval(() => this._tick(), this._tickMs);
+    this._interval.unref?.();
+  }
+
+  _stop() {
+    if (!this._interval) return;
+    clearInterval(this._interval);
+    this._interval = null;
+  }
+
+  _tick() {
+    this._cursor = (this._cursor + 1) % this._slots.length;
+    const slot = this._slots[this._cursor];
+    if (slot.size === 0) return;
+
+    // Snapshot: callbacks may schedule into this same slot for a later round
+    for (const handle of Array.from(slot)) {
+      if (!slot.has(handle)) continue;
+      if (handle.rounds > 0) {
+        handle.rounds--;
+        continue;
+      }
+      slot.delete(handle);
+      this._size--;
+      handle.callback();
+    }
+
+    if (this._size === 0) this._stop();
+  }
+
+  /**
+   * Drop all scheduled callbacks without running them.
+   */
+  destroy() {
+    for (const slot of this._slots) slot.clear();
+    this._size = 0;
+    this._stop();
+  }
+}
+
+module.exports = { TimerWheel };
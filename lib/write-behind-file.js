@@ -0,0 +1,81 @@
+/**
+ * Debounced write-behind of an in-memory state to a file.
+ *
+ * Owners call schedule() after changing their state; the state is
+ * serialized and written with writeFileAtomic() once the debounce expires.
+ * Writes are serialized, so an older snapshot never lands after a newer
+ * one, and a failed write leaves the state dirty for the next attempt.
+ */
+
+const { writeFileAtomic } = require('./atomic-write');
+
+class WriteBehindFile {
+  /**
+   * @param {Object} options
+   * @param {string} options.path - Target file
+   * @param {Function} options.serialize - () => string, the content to write now
+   * @param {number} [options.debounce=250] - Delay before changes are written (ms)
+   * @param {boolean} [options.unref=false] - Don't keep the process alive for a pending write
+   * @param {Function} [options.onWrite] - (content) => void, called as each write starts
+   * @param {Function} [options.onError] - (err) => void, called when a write fails
+   */
+  constructor(options) {
+    this._path = options.path;
+    this._serialize = options.serialize;
+    this._debounce = options.debounce ?? 250;
+    this._unref = !!options.unref;
+    this._onWrite = options.onWrite || (() => {});
+    this._onError = options.onError || (() => {});
+
+    this._timer = null;
+    this._writing = null; // Promise of the write in progress
+    this._dirty = false;
+  }
+
+  /**
+   * Whether changes are waiting to be written or a write is in progress.
+   * @returns {boolean}
+   */
+  get pending() {
+    return this._dirty || this._writing !== null;
+  }
+
+  /**
+   * Mark the state changed and write it after the debounce.
+   */
+  schedule() {
+    this._dirty = true;
+    if (this._timer) return;
+    this._timer = setTimeout(() => {
+      this._timer = null;
+      this.flush();
+    }, this._debounce);
+    if (this._unref) this._timer.unref?.();
+  }
+
+  /**
+   * Write pending changes now, after any write already in flight.
+   * @returns {Promise<void>}
+   */
+  async flush() {
+    clearTimeout(this._timer);
+    this._timer = null;
+    while (this._writing) await this._writing;
+    if (!this._dirty) return;
+
+    this._dirty = false;
+    const content = this._serialize();
+    this._onWrite(content);
+    this._writing = writeFileAtomic(this._path, content)
+      .catch((err) => {
+        this._dirty = true;
+        this._onError(err);
+      })
+      .finally(() => {
+        this._writing = null;
+      });
+    await this._writing;
+  }
+}
+
+module.exports = { WriteBehindFile };
@@ -0,0 +1,177 @@
+/**
+ * Per-device write scheduler.
+ *
+ * Serializes writes to the device at most once per `writeInterval` (roughly
+ * the link's connection interval) and keeps latency bounded under bursty
+ * input: a coalescing command replaces any coalescing commands still waiting
+ * in the queue (latest value wins) and cancels their remaining steps. Only
+ * writes not yet issued are discarded: a command whose first write is in
+ * flight or awaiting a forwarder's ack keeps that write's result.
+ * Timed steps (repeats, holds) are run by a SequenceEngine.
+ *
+ * A write that is only handed off, e.g. to a forwarder node's send window,
+ * returns `{ acked }` instead of a boolean: the queue moves on once it is
+ * handed off, and the command's WriteResult comes from `acked` later.
+ */
+
+const { SequenceEngine } = require('./sequence-engine');
+const { WriteResult } = require('./constants');
+
+class WriteScheduler {
+  /**
+   * @param {Object} options
+   * @param {number} [options.writeInterval=30] - Minimum spacing between writes (ms)
+   * @param {number} [options.maxQueue=32] - Max queued writes; extra commands are dropped
+   * @param {Function} write - async (buffer, trace) => boolean | { acked: Promise<string> }, performs the actual write
+   * @param {Object} logger - Logger instance
+   */
+  constructor(options, write, logger) {
+    this._writeInterval = options.writeInterval ?? 30;
+    this._maxQueue = options.maxQueue || 32;
+    this._write = write;
+    this._logger = logger.child('write-queue');
+
+    this._queue = []; // { buffer, sequence, trace, first }
+    this._busy = false;
+    this._lastWriteAt = 0;
+    this._stats = { writes: 0, failures: 0, coalesced: 0, stepsCancelled: 0, dropped: 0 };
+    this._engine = new SequenceEngine((step, sequence) => {
+      // Only the first step carries the command's latency trace
+      const first = sequence.next === 1;
+      this._queue.push({ buffer: step.buffer, sequence, trace: first ? sequence.trace : null, first });
+      this._pump();
+    });
+  }
+
+  /**
+   * Queue a command's steps.
+   * @param {Array<{ buffer: Buffer, offset: number }>} steps - From planCommand()
+   * @param {Object} [options]
+   * @param {boolean} [options.coalesce=false] - Supersede queued and pending coalescing commands
+   * @param {Object} [options.trace] - Latency trace passed to write() with the first step
+   * @returns {Promise<string>} WriteResult of the first write
+   */
+  submit(steps, options = {}) {
+    const { coalesce = false, trace = null } = options;
+
+    if (coalesce) this._supersede();
+
+    if (steps.length === 0) return Promise.resolve(WriteResult.FAILED);
+
+    if (this._queue.length >= this._maxQueue) {
+      this._stats.dropped++;
+      this._logger.warn('Write queue full, dropping command');
+      return Promise.resolve(WriteResult.DROPPED);
+    }
+
+    return new Promise((resolve) => {
+      this._engine.start(steps, { coalesce, trace, resolve, written: false, dispatched: false });
+    });
+  }
+
+  /**
+   * Drop queued coalescing writes and cancel the remaining steps of
+   * coalescing sequences. A sequence whose first write was already issued
+   * only loses its later steps and is settled by that write's result.
+   */
+  _supersede() {
+    this._stats.stepsCancelled += this._engine.cancelWhere((sequence) => {
+      if (!sequence.coalesce) return false;
+      if (!sequence.dispatched) this._settle(sequence, WriteResult.SUPERSEDED);
+      return true;
+    });
+
+    const kept = [];
+    for (const entry of this._queue) {
+      if (entry.sequence.coalesce) {
+        this._stats.coalesced++;
+        if (!entry.sequence.dispatched) this._settle(entry.sequence, WriteResult.SUPERSEDED);
+      } else {
+        kept.push(entry);
+      }
+    }
+    this._queue = kept;
+  }
+
+  /**
+   * Resolve a sequence's promise with its first write result.
+   * @param {Object} sequence
+   * @param {string} result - WriteResult
+   */
+  _settle(sequence, result) {
+    if (sequence.written) return;
+    sequence.written = true;
+    sequence.resolve(result);
+  }
+
+  /**
+   * Write queued entries one at a time, spaced by writeInterval.
+   */
+  async _pump() {
+    if (this._busy) return;
+    this._busy = true;
+
+    while (this._queue.length > 0) {
+      const wait = this._lastWriteAt + this._writeInterval - Date.now();
+      if (wait > 0) {
+        await new Promise(resolve => setTimeout(resolve, wait));
+        continue; // the queue may have been coalesced while waiting
+      }
+
+      const entry = this._queue.shift();
+      if (entry.first) entry.sequence.dispatched = true;
+      let result = false;
+      try {
+        result = await this._write(entry.buffer, entry.trace);
+      } catch (err) {
+        this._logger.error('Write failed', { error: err.message });
+      }
+      this._lastWriteAt = Date.now();
+      this._stats.writes++;
+      if (result && typeof result === 'object') {
+        // Handed off: don't hold the queue for the acknowledgement
+        result.acked.then(acked => this._finishWrite(entry, acked), () => this._finishWrite(entry, WriteResult.FAILED));
+      } else {
+        this._finishWrite(entry, result ? WriteResult.WRITTEN : WriteResult.FAILED);
+      }
+    }
+
+    this._busy = false;
+  }
+
+  _finishWrite(entry, result) {
+    if (result === WriteResult.FAILED) this._stats.failures++;
+    if (entry.first) this._settle(entry.sequence, result);
+  }
+
+  /**
+   * Get queue depth, counters and step timing.
+   * @returns {{ depth: number, activeSequences: number, writes: number, failures: number, coalesced: number, stepsCancelled: number, dropped: number, jitterMs: Object }}
+   */
+  getStats() {
+    const engine = this._engine.getStats();
+    return {
+      depth: this._queue.length,
+      activeSequences: engine.active,
+      ...this._stats,
+      jitterMs: engine.jitterMs,
+    };
+  }
+
+  /**
+   * Drop all queued writes and pending steps. Commands whose first write
+   * was already issued are still settled by that write.
+   */
+  clear() {
+    this._engine.cancelWhere((sequence) => {
+      if (!sequence.dispatched) this._settle(sequence, WriteResult.DROPPED);
+      return true;
+    });
+    for (const entry of this._queue) {
+      if (!entry.sequence.dispatched) this._settle(entry.sequence, WriteResult.DROPPED);
+    }
+    this._queue = [];
+  }
+}
+
+module.exports = { WriteScheduler };
@@ -1,5 +1,6 @@
 const fs = require('fs');
 const path = require('path');
+const { performance } = require('perf_hooks');
 const express = require('express');
 const http = require('http');
 const { Server } = require('socket.io');
@@ -8,9 +9,26 @@ const bodyParser = require('body-parser');
 
 const { Logger } = require('./lib/logger');
 const { loadDeviceModule } = require('./lib/device-loader');
-const { BleDevice } = require('./lib/ble-device');
+const { createBleDevice } = require('./lib/ble-device-proxy');
 const { NodePool } = require('./lib/node-pool');
-const { MSG_AUTH, MSG_AUTH_RESULT, parseMessage, formatMessage } = require('./lib/node-protocol');
+const { WriteScheduler } = require('./lib/write-scheduler');
+const { planCommand } = require('./lib/sequence-engine');
+const { LatencyTracer, markTrace } = require('./lib/latency-tracer');
+const { registry: metricsRegistry } = require('./lib/metrics');
+const { KvStore } = require('./lib/kv-store');
+const { CommandJournal } = require('./lib/command-journal');
+const { ScanSessionManager } = require('./lib/scan-session');
+const { TelemetryCache } = require('./lib/telemetry-cache');
+const { TelemetryHub } = require('./lib/telemetry-hub');
+const { WriteResult } = require('./lib/constants');
+const {
+  MSG_AUTH,
+  MSG_AUTH_RESULT,
+  parseMessage,
+  formatMessage,
+  CAP_COMMAND_SPEC,
+  negotiateCapabilities,
+} = require('./lib/node-protocol');
 
 
 /**
@@ -66,7 +84,13 @@ const AUTH_ENABLED = rawToken && rawToken !== 'none' && rawToken.trim() !== '';
 const AUTH_TOKEN = AUTH_ENABLED ? rawToken : null;
 
 // Initialize logger
-const logger = new Logger({ level: config.logging?.level || 'info' });
+const logger = new Logger({
+  level: config.logging?.level || 'info',
+  format: config.logging?.format,
+  file: config.logging?.file,
+  levels: config.logging?.levels,
+  ringSize: config.logging?.ringSize,
+});
 const bleLogger = logger.child('ble');
 const httpLogger = logger.child('http');
 const wsLogger = logger.child('websocket');
@@ -84,25 +108,72 @@ const port = process.env.PORT || config.server?.port || 3000;
 const nodesEnabled = config.nodes?.enabled !== false;
 const nodePool = new NodePool(config.nodes || {}, logger);
 
+// Per-stage command latency, from request receipt to the first BLE write
+const latencyTracer = new LatencyTracer({
+  enabled: config.tracing?.enabled,
+  recent: config.tracing?.recent,
+});
+
 // Local BLE device (used as fallback when no forwarder nodes are available)
-const bleDevice = new BleDevice({
+const bleDevice = createBleDevice({
   macAddress: config.device.macAddress,
   addressType: config.device.addressType,
   hciInterface: config.ble?.hciInterface,
   reconnectDelay: config.ble?.reconnectDelay,
+  reconnectBaseDelay: config.ble?.reconnectBaseDelay,
   deviceNamePatterns: config.ble?.deviceNamePatterns,
   scanDuration: config.ble?.scanDuration,
+  scanMaxDevices: config.ble?.scanMaxDevices,
+  scanDeviceTtl: config.ble?.scanDeviceTtl,
+  writeMode: config.ble?.writeMode,
+  writeBarrierEvery: config.ble?.writeBarrierEvery,
+  binding: config.ble?.binding,
+  simulator: config.ble?.simulator,
+  isolate: config.ble?.isolate,
+  discoveryCache: config.ble?.discoveryCache === false ? ''
+    : process.env.DISCOVERY_CACHE_PATH || config.ble?.discoveryCachePath || path.join(__dirname, 'discovery-cache.json'),
+  discoveryCacheTtl: config.ble?.discoveryCacheTtl,
+  requestTimeout: config.ble?.requestTimeout,
   batteryCheckInterval: config.ble?.batteryCheckInterval,
 }, logger, deviceModule);
 
-let batteryLevel = 100;
+// Scans requested by browsers and the API share one radio scan
+const scanSessions = new ScanSessionManager({
+  updateInterval: config.ble?.scanUpdateInterval,
+  maxDevices: config.ble?.scanMaxDevices,
+  deviceTtl: config.ble?.scanDeviceTtl,
+}, (duration, options) => bleDevice.scan(duration, options), logger);
+
+// Battery and RSSI reads from all clients share one device or node transaction
+const telemetry = new TelemetryCache(logger)
+  .define('battery', {
+    maxAge: config.telemetry?.batteryMaxAge || 60000,
+    maxStale: config.telemetry?.batteryMaxStale || 600000,
+    fetch: async () => {
+      if (bleDevice.isConnected()) return bleDevice.readBattery();
+      if (nodePool.getActiveNode()) return nodePool.requestBattery();
+      return null;
+    },
+  })
+  .define('rssi', {
+    maxAge: config.telemetry?.rssiMaxAge || 2000,
+    maxStale: config.telemetry?.rssiMaxStale || 10000,
+    fetch: async () => {
+      if (bleDevice.isConnected()) return bleDevice.getRssi();
+      if (nodePool.getActiveNode()) return nodePool.requestRssi();
+      return null;
+    },
+  });
 
 // Forward BLE device events
 bleDevice.on('battery', (level) => {
-  batteryLevel = level;
+  telemetry.set('battery', level);
 });
 
 bleDevice.on('disconnected', () => {
+  // RSSI belongs to a link; a node's will differ
+  clearRssiTelemetry();
+
   // If nodes are enabled, trigger handoff to remote nodes
   if (nodesEnabled && nodePool.hasNodes()) {
     nodeLogger.info('Local BLE disconnected, triggering node pool handoff');
@@ -112,7 +183,11 @@ bleDevice.on('disconnected', () => {
 
 // Forward node pool battery events
 nodePool.on('battery', (level) => {
-  batteryLevel = level;
+  telemetry.set('battery', level);
+});
+
+nodePool.on('active:changed', () => {
+  clearRssiTelemetry();
 });
 
 /**
@@ -128,142 +203,196 @@ function getNodesPayload() {
 }
 
 /**
- * Broadcast node pool state to all connected browser clients.
+ * Current link to the device: local adapter, a forwarder node, or none.
  */
-function broadcastNodes() {
-  io.emit('nodes', getNodesPayload());
+function getLinkState() {
+  const activeNodeId = nodePool.getActiveNode()?.nodeId || null;
+  if (bleDevice.isConnected()) return { connected: true, via: 'local' };
+  return { connected: !!activeNodeId, via: activeNodeId ? 'node' : null };
 }
 
-// Broadcast on node pool and local BLE state changes
-nodePool.on('node:connected', broadcastNodes);
-nodePool.on('node:disconnected', broadcastNodes);
-nodePool.on('active:changed', broadcastNodes);
-nodePool.on('no:active', broadcastNodes);
-bleDevice.on('connected', broadcastNodes);
-bleDevice.on('disconnected', broadcastNodes);
+// Telemetry pushed to subscribed browser clients. Battery and RSSI are
+// sampled through the telemetry cache at the fastest subscribed rate; the
+// other channels change on events.
+const telemetryHub = new TelemetryHub(logger)
+  .define('battery', {
+    read: () => telemetry.get('battery'),
+    sample: true,
+    minInterval: config.telemetry?.batteryMaxAge || 60000,
+    defaultInterval: 60000,
+  })
+  .define('rssi', {
+    read: () => telemetry.get('rssi'),
+    sample: true,
+    minInterval: config.telemetry?.rssiMaxAge || 2000,
+    defaultInterval: 2000,
+  })
+  .define('link', { read: getLinkState })
+  .define('activeNode', { read: () => ({ nodeId: nodePool.getActiveNode()?.nodeId || null }) })
+  .define('nodes', { read: getNodesPayload });
+
+// Values that reach the cache without a sample, e.g. battery notifications
+telemetry.on('update', (name, value) => telemetryHub.publish(name, value));
 
-// Key-value storage for persistent values (support override via env var for Electron embedding)
-const KV_STORAGE_PATH = process.env.KV_STORAGE_PATH || path.join(__dirname, 'kvStorage.json');
+/**
+ * Drop the RSSI of a link that went away, from the cache and from
+ * subscribers' screens.
+ */
+function clearRssiTelemetry() {
+  telemetry.invalidate('rssi');
+  telemetryHub.clear('rssi');
+}
 
-function loadKvStorage() {
-  if (!fs.existsSync(KV_STORAGE_PATH)) {
-    const initial = {
-      pValue: 10,
-      pValueDate: new Date().toISOString(),
-      sValue: 0,
-      sValueDate: new Date().toISOString(),
-    };
-    fs.writeFileSync(KV_STORAGE_PATH, JSON.stringify(initial, null, 2));
-    return initial;
-  }
-  return JSON.parse(fs.readFileSync(KV_STORAGE_PATH, 'utf8'));
+/**
+ * Push link and node pool state to subscribers if it changed.
+ */
+function refreshLinkTelemetry() {
+  telemetryHub.refresh('link');
+  telemetryHub.refresh('activeNode');
+  telemetryHub.refresh('nodes');
 }
 
-let kvStorage = loadKvStorage();
+// Node pool and local BLE state changes
+nodePool.on('node:connected', refreshLinkTelemetry);
+nodePool.on('node:disconnected', refreshLinkTelemetry);
+nodePool.on('active:changed', refreshLinkTelemetry);
+nodePool.on('no:active', refreshLinkTelemetry);
+bleDevice.on('connected', refreshLinkTelemetry);
+bleDevice.on('disconnected', refreshLinkTelemetry);
 
-function getValue(key) {
-  kvStorage = loadKvStorage();
-  const today = new Date().getDate();
+// Key-value storage for persistent values (support override via env var for Electron embedding)
+const KV_STORAGE_PATH = process.env.KV_STORAGE_PATH || path.join(__dirname, 'kvStorage.json');
 
-  if (key === 'pValue') {
-    const storedDate = new Date(kvStorage.pValueDate).getDate();
-    if (storedDate !== today) {
-      kvStorage.pValue = 10;
-      kvStorage.pValueDate = new Date().toISOString();
-      saveKvStorage();
-    }
-    return kvStorage.pValue;
-  } else if (key === 'sValue') {
-    const storedDate = new Date(kvStorage.sValueDate).getDate();
-    if (storedDate !== today) {
-      kvStorage.sValue = 0;
-      kvStorage.sValueDate = new Date().toISOString();
-      saveKvStorage();
-    }
-    return kvStorage.sValue;
-  }
-  return null;
+// Values live in memory; changes are written behind, atomically
+const kvStore = new KvStore({
+  path: KV_STORAGE_PATH,
+  keys: {
+    pValue: { type: 'number', default: 10, resetDaily: true },
+    sValue: { type: 'number', default: 0, resetDaily: true },
+  },
+}, logger);
+
+function getValue(key) {
+  return kvStore.get(key);
 }
 
+// Append-only history of sent commands (support override via env var for Electron embedding)
+const journal = config.journal?.enabled === false ? null : new CommandJournal({
+  dir: process.env.JOURNAL_PATH || config.journal?.dir || path.join(__dirname, 'journal'),
+  controlIds: deviceModule.controls.map(ctrl => ctrl.id),
+  segmentSize: config.journal?.segmentSize,
+  segmentMaxAge: config.journal?.segmentMaxAge,
+  flushInterval: config.journal?.flushInterval,
+  maxAge: config.journal?.maxAge,
+  maxBytes: config.journal?.maxBytes,
+}, logger);
+
 function setValue(key, value) {
   if (key === 'pValue') {
     const progressiveCtrl = deviceModule.controls.find(c => c.id === deviceModule.progressiveControlId);
     const maxValue = progressiveCtrl ? progressiveCtrl.max : 100;
-    kvStorage.pValue = Math.min(value, maxValue);
-    kvStorage.pValueDate = new Date().toISOString();
-  } else if (key === 'sValue') {
-    kvStorage.sValue = value;
-    kvStorage.sValueDate = new Date().toISOString();
+    value = Math.min(value, maxValue);
   }
-  saveKvStorage();
-}
-
-function saveKvStorage() {
-  fs.writeFileSync(KV_STORAGE_PATH, JSON.stringify(kvStorage, null, 2));
+  kvStore.set(key, value);
 }
 
 /**
  * Write data to the BLE device or route via node pool.
  * Tries local BLE first, then falls back to the node pool.
+ * @param {Buffer} data - Raw command data
+ * @param {Object|null} [trace] - Latency trace (first step of a command only)
+ * @returns {Promise<boolean|{ acked: Promise<boolean> }>} Local write result, or the node's pending ack
  */
-async function bleWriteAsync(data) {
+async function bleWriteAsync(data, trace = null) {
   // Try local BLE first
   if (bleDevice.isConnected()) {
-    return bleDevice.write(data);
+    markTrace(trace, 'write');
+    const success = await bleDevice.write(data);
+    markTrace(trace, 'written');
+    return success;
   }
 
-  // Fall back to node pool
+  // Fall back to node pool. The node's send window paces commands, so the
+  // write queue only waits for the hand-off, not for the node's ack.
   if (nodePool.getActiveNode()) {
-    return nodePool.sendCommand(data);
+    return { acked: nodePool.sendCommand(data, { trace }) };
   }
 
   bleLogger.warn('Cannot write: no local BLE and no active forwarder node');
   return false;
 }
 
+// Serializes device writes and lets newer range values supersede queued ones
+const writeScheduler = new WriteScheduler({
+  writeInterval: config.ble?.writeInterval,
+  maxQueue: config.ble?.writeQueueLimit,
+}, bleWriteAsync, logger);
+
 /**
- * Fire-and-forget write wrapper.
+ * Fire-and-forget dispatch of a command's timed steps.
+ * Runs the steps on the local write queue, or hands the whole sequence to
+ * the active forwarder when it can run sequences itself.
+ * @param {Array<{ buffer: Buffer, offset: number }>} steps - From planCommand()
+ * @param {Object} [options] - { coalesce, trace }
+ * @param {Function} onDone - Called with the WriteResult of the first write
  */
-function bleWrite(data) {
-  bleWriteAsync(data);
+function bleWrite(steps, options, onDone) {
+  const done = !bleDevice.isConnected() && nodePool.supportsSequences()
+    ? nodePool.sendSequence(steps, options)
+    : writeScheduler.submit(steps, options);
+  done.then(onDone);
   return bleDevice.isConnected() || !!nodePool.getActiveNode();
 }
 
 /**
  * Send a command to the device.
  * Uses the device module to build command buffers from control values.
- * @param {Object} commands - Control values (e.g., { shock: 50, vibro: 20, sound: 0 })
+ * @param {Object} input - Control values (e.g., { shock: 50, vibro: 20, sound: 0 }); other keys are ignored
  * @param {string} originator - Source of the command for logging
+ * @param {Object|null} [trace] - Latency trace started when the command arrived
  */
-function sendCommand(commands, originator = 'server') {
-  // Clamp range values per control definitions
+function sendCommand(input, originator = 'server', trace = latencyTracer.begin('server')) {
+  const receivedAt = trace ? trace.marks.received : performance.now();
+  // Keep only the device's controls, clamping range values. Anything else,
+  // e.g. the token in /api/command's query string, must not reach the log,
+  // the journal or a forwarder.
+  const commands = {};
   for (const ctrl of deviceModule.controls) {
-    if (ctrl.type === 'range' && commands[ctrl.id] !== undefined) {
-      commands[ctrl.id] = Math.max(
-        ctrl.min,
-        Math.min(ctrl.max, Math.round(commands[ctrl.id]))
-      );
-    }
+    if (input[ctrl.id] === undefined) continue;
+    commands[ctrl.id] = ctrl.type === 'range'
+      ? Math.max(ctrl.min, Math.min(ctrl.max, Math.round(input[ctrl.id])))
+      : input[ctrl.id];
   }
 
   if (originator !== 'resend') {
     bleLogger.info(`Command from ${originator}`, commands);
   }
 
-  const result = deviceModule.buildCommand(commands);
-  if (!result || !result.buffer) {
-    bleLogger.warn('Device module returned no command buffer');
-    return false;
-  }
+  // Range-only commands are superseded by newer ones; actions (e.g. find) are not
+  const coalesce = !deviceModule.controls.some(ctrl => ctrl.type === 'action' && commands[ctrl.id]);
 
-  const success = bleWrite(result.buffer);
+  const route = bleDevice.isConnected() ? 'local' : (nodePool.getActiveNode()?.nodeId ?? null);
+  const finish = (result) => {
+    latencyTracer.finish(trace, result);
+    if (journal) journal.append(originator, commands, route, performance.now() - receivedAt, result);
+  };
+
+  // A forwarder with the same device module builds and times the command itself
+  if (!bleDevice.isConnected() && nodePool.supportsCommandSpecs()) {
+    markTrace(trace, 'dispatched');
+    nodePool.sendCommandSpec(commands, { coalesce, trace }).then(finish);
+    return true;
+  }
 
-  // Handle repeat if the module requests it
-  if (result.repeat && result.repeatDelay) {
-    setTimeout(() => bleWrite(result.buffer), result.repeatDelay);
+  const steps = planCommand(deviceModule.buildCommand(commands));
+  if (steps.length === 0) {
+    bleLogger.warn('Device module returned no command buffer');
+    finish(WriteResult.FAILED);
+    return false;
   }
 
-  return success;
+  markTrace(trace, 'dispatched');
+  return bleWrite(steps, { coalesce, trace }, finish);
 }
 
 // WebSocket server for forwarder nodes (raw WebSocket, not Socket.io)
@@ -281,7 +410,9 @@ wss.on('connection', (ws) => {
     }
   }, 5000);
 
-  ws.on('message', (raw) => {
+  ws.on('message', (raw, isBinary) => {
+    // Binary frames are only valid after auth; NodePool handles them
+    if (isBinary) return;
     const msg = parseMessage(raw.toString());
     if (!msg) return;
 
@@ -305,11 +436,14 @@ wss.on('connection', (ws) => {
       nodeId = msg.nodeId || `node-${Date.now()}`;
       clearTimeout(authTimeout);
 
-      ws.send(formatMessage(MSG_AUTH_RESULT, { success: true }));
-      nodeLogger.info(`Node ${nodeId} authenticated`);
+      // command_spec needs both sides to build commands with the same module
+      const capabilities = negotiateCapabilities(msg.capabilities)
+        .filter(cap => cap !== CAP_COMMAND_SPEC || msg.deviceModule === deviceModule.name);
+      ws.send(formatMessage(MSG_AUTH_RESULT, { success: true, capabilities }));
+      nodeLogger.info(`Node ${nodeId} authenticated`, { capabilities });
 
       // Add to pool (pool handles all subsequent messages)
-      nodePool.addNode(ws, nodeId);
+      nodePool.addNode(ws, nodeId, { capabilities });
       return;
     }
     // After auth, messages are handled by NodePool via its own ws.on('message')
@@ -344,13 +478,42 @@ if (AUTH_ENABLED) {
   });
 }
 
+// Socket.io metrics; series are created up front so counting never allocates
+const socketEvents = metricsRegistry.counter('socketio_events_total', 'Socket.io events received', {
+  labelNames: ['event'],
+});
+const SOCKET_EVENT_SERIES = new Map(
+  ['command', 'sendandincrease', 'getrssi', 'getnodes', 'getbattery', 'subscribe', 'unsubscribe', 'scan:start', 'scan:cancel', 'shutdown']
+    .map(event => [event, socketEvents.labels(event)])
+);
+const otherSocketEvents = socketEvents.labels('other');
+metricsRegistry.gauge('socketio_clients', 'Connected Socket.io clients')
+  .collect(() => io.engine.clientsCount);
+
 // Socket.io event handlers (browser clients)
 io.on('connection', (socket) => {
   const clientIp = getSocketClientIp(socket);
   wsLogger.info(`Client connected`, { address: clientIp });
 
+  socket.onAny((event) => {
+    (SOCKET_EVENT_SERIES.get(event) || otherSocketEvents).inc();
+  });
+
+  // Until a client subscribes itself, it gets node pool changes as before
+  const push = (channel, value) => socket.emit(channel, value);
+  telemetryHub.subscribe(socket, { nodes: 0 }, push);
+
+  socket.on('subscribe', (requests = {}) => {
+    const accepted = telemetryHub.subscribe(socket, requests, push);
+    socket.emit('subscribed', accepted);
+  });
+
+  socket.on('unsubscribe', (channels) => {
+    telemetryHub.unsubscribe(socket, Array.isArray(channels) ? channels : undefined);
+  });
+
   socket.on('command', (data) => {
-    sendCommand(data, clientIp);
+    sendCommand(data, clientIp, latencyTracer.begin('socket'));
   });
 
   socket.on('sendandincrease', () => {
@@ -359,25 +522,17 @@ io.on('connection', (socket) => {
       wsLogger.warn('Device module has no progressiveControlId, ignoring sendandincrease');
       return;
     }
+    const trace = latencyTracer.begin('socket');
     let pValue = getValue('pValue');
-    sendCommand({ [controlId]: pValue }, clientIp);
+    sendCommand({ [controlId]: pValue }, clientIp, trace);
     pValue += 10;
     setValue('pValue', pValue);
   });
 
   socket.on('getrssi', async () => {
-    // Try local BLE first
-    if (bleDevice.isConnected()) {
-      const rssi = await bleDevice.getRssi();
-      if (rssi !== null) socket.emit('rssi', rssi);
-      return;
-    }
-
-    // Fall back to node pool
-    if (nodePool.getActiveNode()) {
-      const rssi = await nodePool.requestRssi();
-      if (rssi !== null) socket.emit('rssi', rssi);
-    }
+    // Local BLE first, then the active node; cached across clients
+    const rssi = await telemetry.get('rssi');
+    if (rssi !== null) socket.emit('rssi', rssi);
   });
 
   socket.on('getnodes', () => {
@@ -385,39 +540,61 @@ io.on('connection', (socket) => {
   });
 
   socket.on('getbattery', async () => {
-    // Try local BLE first
-    if (bleDevice.isConnected()) {
-      bleDevice.requestBattery();
-      setTimeout(() => socket.emit('battery', bleDevice.getBatteryLevel()), 1000);
-      return;
-    }
+    // Local BLE first, then the active node; the last known level without either
+    const level = await telemetry.get('battery');
+    socket.emit('battery', level ?? 100);
+  });
 
-    // Fall back to node pool
-    if (nodePool.getActiveNode()) {
-      const level = await nodePool.requestBattery();
-      if (level !== null) {
-        batteryLevel = level;
-        socket.emit('battery', level);
-      } else {
-        socket.emit('battery', batteryLevel);
-      }
-      return;
-    }
+  // Streaming scan: results arrive as scan:devices batches, then scan:end
+  let scanViewer = null;
+  socket.on('scan:start', (options = {}) => {
+    // A new scan replaces this client's previous one without a scan:end for it
+    const previous = scanViewer;
+    const current = {};
+    scanViewer = current;
+    if (previous) previous.viewer.cancel();
+    current.viewer = scanSessions.join({
+      duration: parseInt(options.duration, 10) || config.ble?.scanDuration,
+      showAll: options.showAll === true,
+    }, (event, data) => {
+      if (scanViewer !== current) return;
+      if (event === 'end') scanViewer = null;
+      socket.emit(`scan:${event}`, data);
+    });
+  });
 
-    socket.emit('battery', batteryLevel);
+  socket.on('scan:cancel', () => {
+    if (scanViewer) scanViewer.viewer.cancel();
   });
 
   socket.on('shutdown', () => {
     wsLogger.info('Shutdown requested');
-    process.exit();
+    shutdown();
   });
 
   socket.on('disconnect', () => {
+    telemetryHub.unsubscribe(socket);
+    if (scanViewer) scanViewer.viewer.cancel();
     wsLogger.debug('Client disconnected', { address: clientIp });
   });
 });
 
+// HTTP metrics, by status class
+const httpRequests = metricsRegistry.counter('http_requests_total', 'HTTP requests handled', {
+  labelNames: ['status'],
+});
+const HTTP_STATUS_SERIES = ['1xx', '2xx', '3xx', '4xx', '5xx'].map(status => httpRequests.labels(status));
+const httpDuration = metricsRegistry.histogram('http_request_duration_seconds', 'HTTP request handling time');
+
 // HTTP middleware
+app.use((req, res, next) => {
+  const startedAt = performance.now();
+  res.on('finish', () => {
+    HTTP_STATUS_SERIES[Math.min(4, Math.max(0, Math.floor(res.statusCode / 100) - 1))].inc();
+    httpDuration.observe((performance.now() - startedAt) / 1000);
+  });
+  next();
+});
 app.use(bodyParser.json());
 app.use((req, res, next) => {
   res.header('Access-Control-Allow-Origin', '*');
@@ -454,7 +631,7 @@ function validateToken(req, res, next) {
 
 // API routes (all require authentication)
 app.get('/api/command', validateToken, (req, res) => {
-  sendCommand(req.query, getClientIp(req));
+  sendCommand(req.query, getClientIp(req), latencyTracer.begin('http'));
   res.send('OK');
 });
 
@@ -464,14 +641,15 @@ app.get('/api/shockandincrease', validateToken, (req, res) => {
     res.status(400).json({ error: 'Device does not support progressive commands' });
     return;
   }
+  const trace = latencyTracer.begin('http');
   let pValue = getValue('pValue') + 10;
-  sendCommand({ [controlId]: pValue }, getClientIp(req));
+  sendCommand({ [controlId]: pValue }, getClientIp(req), trace);
   setValue('pValue', pValue);
   res.send('OK');
 });
 
 app.get('/api/battery', validateToken, (req, res) => {
-  res.send(batteryLevel.toString());
+  res.send(String(telemetry.peek('battery') ?? 100));
 });
 
 app.get('/api/pValue', validateToken, (req, res) => {
@@ -501,18 +679,95 @@ app.get('/api/device/info', validateToken, (req, res) => {
     name: deviceModule.name,
     displayName: deviceModule.displayName,
     controls: deviceModule.controls,
-    hasBattery: typeof deviceModule.buildBatteryRequest === 'function',
+    hasBattery: !!deviceModule.requests.battery,
+  });
+});
+
+// Blocking scan: joins the shared scan and answers with the final list
+app.get('/api/scan', validateToken, (req, res) => {
+  const viewer = scanSessions.join({
+    duration: parseInt(req.query.duration, 10) || 10000,
+    showAll: req.query.showAll === 'true',
+  }, (event, data) => {
+    if (event !== 'end' || res.headersSent) return;
+    if (data.reason === 'error') {
+      res.status(503).json({ error: 'BLE scan failed', message: data.error });
+    } else {
+      res.json(data.devices);
+    }
+  });
+  res.on('close', viewer.cancel);
+});
+
+// Streaming scan over Server-Sent Events: 'devices' batches, then 'end'
+app.get('/api/scan/stream', validateToken, (req, res) => {
+  res.writeHead(200, {
+    'Content-Type': 'text/event-stream',
+    'Cache-Control': 'no-cache',
+    Connection: 'keep-alive',
+  });
+  const viewer = scanSessions.join({
+    duration: parseInt(req.query.duration, 10) || 10000,
+    showAll: req.query.showAll === 'true',
+  }, (event, data) => {
+    res.write(`event: ${event}\ndata: ${JSON.stringify(data)}\n\n`);
+    if (event === 'end') res.end();
+  });
+  req.on('close', viewer.cancel);
+});
+
+// Command path statistics
+app.get('/api/stats', validateToken, (req, res) => {
+  res.json({
+    writeQueue: writeScheduler.getStats(),
+    telemetry: telemetryHub.getStats(),
   });
 });
 
-app.get('/api/scan', validateToken, async (req, res) => {
-  const duration = parseInt(req.query.duration, 10) || 10000;
-  const showAll = req.query.showAll === 'true';
+// Prometheus metrics
+app.get('/metrics', validateToken, (req, res) => {
+  res.set('Content-Type', metricsRegistry.contentType);
+  res.send(metricsRegistry.render());
+});
+
+// Recent log records from the in-memory ring, oldest first
+app.get('/api/logs/tail', validateToken, (req, res) => {
+  res.json(logger.tail({
+    limit: parseInt(req.query.lines, 10) || 100,
+    level: req.query.level,
+    prefix: req.query.logger,
+  }));
+});
+
+// Per-stage command latency; ?reset=true clears the histograms after reading
+app.get('/api/latency', validateToken, (req, res) => {
+  res.json(latencyTracer.getStats());
+  if (req.query.reset === 'true') latencyTracer.reset();
+});
+
+// Command history from the journal; from/to are ms since epoch or ISO dates
+app.get('/api/history', validateToken, async (req, res) => {
+  if (!journal) {
+    res.status(404).json({ error: 'Command journal is disabled' });
+    return;
+  }
+  const parseTime = (value, fallback) => {
+    if (value === undefined) return fallback;
+    const time = /^\d+$/.test(value) ? Number(value) : Date.parse(value);
+    return Number.isNaN(time) ? null : time;
+  };
+  const to = parseTime(req.query.to, Date.now());
+  const from = parseTime(req.query.from, to - 3600000);
+  if (from === null || to === null) {
+    res.status(400).json({ error: 'Invalid from/to' });
+    return;
+  }
+  const limit = Math.min(parseInt(req.query.limit, 10) || 1000, 10000);
   try {
-    const devices = await bleDevice.scan(duration, { showAll });
-    res.json(devices);
+    res.json(await journal.query(from, to, limit));
   } catch (err) {
-    res.status(503).json({ error: 'BLE scan failed', message: err.message });
+    httpLogger.error('History query failed', { error: err.message });
+    res.status(500).json({ error: 'History query failed', message: err.message });
   }
 });
 
@@ -522,6 +777,7 @@ app.get('/api/nodes', validateToken, (req, res) => {
     nodes: nodePool.getNodes(),
     activeNodeId: nodePool.getActiveNode()?.nodeId || null,
     localBleConnected: bleDevice.isConnected(),
+    commands: nodePool.getCommandStats(),
   });
 });
 
@@ -575,32 +831,50 @@ server.listen(port, host, () => {
 });
 
 // Graceful shutdown
-process.on('SIGINT', () => {
+function shutdown() {
   logger.info('Shutting down...');
   const cleanup = async () => {
+    writeScheduler.clear();
+    telemetryHub.close();
+    scanSessions.destroy();
+    await kvStore.close();
+    if (journal) await journal.close();
     nodePool.destroy();
     await bleDevice.destroy();
     process.exit();
   };
   cleanup();
-});
+}
+
+process.on('SIGINT', shutdown);
+// The Electron wrapper stops the server with SIGTERM
+process.on('SIGTERM', shutdown);
 
 /**
  * Start the application.
  * Connects local BLE automatically. If forwarder nodes are enabled,
  * they can take over when they connect and have better proximity.
+ *
+ * The startup scan and the connection run concurrently on one radio scan:
+ * connect() starts as soon as the device advertises (on macOS/Windows it
+ * picks the device out of the running scan; on Linux it connects by
+ * address right away), and the scan runs on in the background for the
+ * device report.
  */
 async function start() {
+  bleDevice.once('connected', () => {
+    bleLogger.info(`First connection ${Math.round(performance.now())}ms after startup`);
+  });
+
   // Always try to connect local BLE (acts as fallback)
   if (config.ble?.scanOnStart !== false) {
-    try {
-      const devices = await bleDevice.scan();
+    bleDevice.scan().then((devices) => {
       if (devices.length > 0) {
         bleLogger.info('Compatible devices found during scan:', devices);
       }
-    } catch (err) {
+    }, (err) => {
       bleLogger.error('Scan failed', { error: err.message });
-    }
+    });
   } else {
     bleLogger.info('Scan on start disabled, connecting immediately');
   }